@@ -2,97 +2,676 @@
 #include <cstring>
 #include <vector>
 #include <bitset>
+#include <array>
 #include <algorithm>
+#include <cmath>
 #include <stdint.h>
 #include <fstream>
 #include <filesystem>
+#include <string_view>
+#include <span>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <optional>
+#include <utility>
+#include <shared_mutex>
+#include <unordered_map>
+#include <exception>
+#include <memory>
+#include <memory_resource>
+#include <chrono>
+#include <random>
+#include <functional>
+#include <sstream>
+#include <type_traits>
+#if defined(_WIN32)
+#include <windows.h>
+#include <io.h>
+#include <fcntl.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if defined(__x86_64__) || defined(_M_X64)
+#include <nmmintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#endif
 
 /**
  * @brief *.hfmtree : file coded with huffman tree
  * [sizeof(std::size_t) bytes]: l1, typed std::size_t, the size of space recording HFMTree::tree
- * [l1 bytes]: HFMTree::tree, recorded in form of [0b10000000][left][root][right][0b10000001]
+ * [l1 bytes]: HFMTree::tree, recorded in form of [0b10000000][left][root][right][0b10000001],
+ *     only for trees of ASCII characters, since other bytes collide with the brackets
  * [sizeof(std::size_t) bytes]: l2, typed std::size_t, the size of following codes in bits !!!bits!!!
  * [l2 bits]: coded text !!!bits!!!
+ *
+ * @brief *.hfmtree with canonical codes : file coded with huffman tree, recording code lengths only
+ * [sizeof(std::size_t) bytes]: HFMTree::canonical_magic, typed std::size_t, never a valid l1
+ * [1 byte]: flags, bit 0 set for code lengths recorded in 1 byte each, otherwise in 4 bits each (high nibble first),
+ *     bit 1 set for code lengths of all 256 bytes, otherwise of the first 128 (ASCII) only, other bits clear
+ * [64, 128 or 256 bytes]: code length of each character, 0 for absent characters
+ * [sizeof(std::size_t) bytes]: l2, typed std::size_t, the size of following codes in bits !!!bits!!!
+ * [l2 bits]: coded text !!!bits!!!
+ *
+ * @brief *.hfmtree in blocks : file coded with huffman trees block by block, see class HFMStream
+ * [sizeof(std::size_t) bytes]: HFMStream::magic, typed std::size_t, never a valid l1
+ * blocks, each of them recorded as:
+ *     [sizeof(std::size_t) bytes]: l0, typed std::size_t, the size of text in the block in bytes, 0 for the end of file
+ *     [1 byte]: flags, bit 0 set for a code-length header following, otherwise the block uses the tree of the previous one,
+ *         bit 1 set for text coded in HFMTree::streams interleaved streams, bit 2 set for a seek index following (bit 1 clear only),
+ *         bit 3 set for a checksum ending the block, other bits clear
+ *     [65, 129 or 257 bytes]: (bit 0 of flags set) code-length header, [flags][code lengths] as in *.hfmtree with canonical codes
+ *     (bit 2 of flags set)
+ *     [sizeof(std::size_t) bytes]: every, typed std::size_t, the number of characters between checkpoints, not 0
+ *     [(l0 - 1) / every * sizeof(std::size_t) bytes]: checkpoints, bit offset in the code of characters every, 2 * every, ...
+ *     (bit 1 of flags clear)
+ *     [sizeof(std::size_t) bytes]: l2, typed std::size_t, the size of following codes in bits !!!bits!!!
+ *     [l2 bits]: coded text of the block !!!bits!!!
+ *     (bit 1 of flags set)
+ *     [4 * sizeof(std::size_t) bytes]: l2 of each stream, typed std::size_t, in bits !!!bits!!!
+ *     [each stream padded to bytes]: coded text of each quarter of the block, see HFMTree::encode_interleaved
+ *     (bit 3 of flags set)
+ *     [4 bytes]: crc, typed uint32_t, CRC32C of the block from l0 to the end of its coded text, see class HFMCRC
+ * [sizeof(std::size_t) bytes]: 0, the end mark
+ * [(n + 1) * 2 * sizeof(std::size_t) bytes]: index, (offset of the block in the file, offset of its text) for each block,
+ *     then (offset of the end mark, size of the whole text)
+ * [sizeof(std::size_t) bytes]: n, typed std::size_t, the number of blocks, files ending right after the end mark have no index
+ *
+ * @brief *.hfmdict : shared dictionary, canonical codes trained once and referenced by messages, see class HFMDictionary
+ * [sizeof(std::size_t) bytes]: HFMDictionary::magic, typed std::size_t
+ * [8 bytes]: id, typed uint64_t, HFMTree::id() of the dictionary
+ * [65, 129 or 257 bytes]: code-length header, [flags][code lengths] as in *.hfmtree with canonical codes
+ *
+ * @brief message coded with a shared dictionary, see HFMDictionary::encode
+ * [8 bytes]: id, typed uint64_t, HFMTree::id() of the dictionary
+ * [sizeof(std::size_t) bytes]: l2, typed std::size_t, the size of following codes in bits !!!bits!!!
+ * [l2 bits]: coded text !!!bits!!!
+ *
+ * @brief order-1 context model : text coded with a code table chosen by the previous character, see class HFMContext
+ * [sizeof(std::size_t) bytes]: HFMContext::magic, typed std::size_t
+ * [32 bytes]: bit c (of byte c / 8, lowest first) set for context c having a code table of its own, otherwise it uses the order-0 one
+ * [65, 129 or 257 bytes]: order-0 code-length header, [flags][code lengths] as in *.hfmtree with canonical codes
+ * [65, 129 or 257 bytes each]: code-length header of each context with a code table of its own, in ascending order
+ * [sizeof(std::size_t) bytes]: l0, typed std::size_t, the size of text in bytes
+ * [sizeof(std::size_t) bytes]: l2, typed std::size_t, the size of following codes in bits !!!bits!!!
+ * [l2 bits]: coded text, the first character with the order-0 codes, every other one with the codes of its context !!!bits!!!
+ *
+ * @brief counter : characters counted, e.g. sent by workers training a tree together, see HFMTree::Counter::write
+ * [varint]: n, the number of characters counted at least once
+ * n times [1 byte][varint]: character, its count, in ascending order of characters
+ * varints are LEB128, 7 bits a byte with the lowest group first, the highest bit set for bytes followed by more
+ *
+ * @brief adaptive stream : text coded in a single pass with a huffman tree updated character by character, see class HFMAdaptive
+ * no header, characters are coded with the path of their leaves, MSB first,
+ * a character never seen before is coded with the path of the NYT (not yet transmitted) leaf and then 9 bits of its value,
+ * HFMAdaptive::sync (then zeros to the end of the byte) is coded when the stream is flushed, HFMAdaptive::eos (then zeros) ends the stream
+ */
+
+/**
+ * @brief
+ * pool of threads running independent tasks, used for counting characters and coding blocks in parallel
+ */
+class HFMPool
+{
+public:
+    /** @brief default number of threads, the number of hardware threads */
+    static std::size_t default_threads() noexcept { return std::max<std::size_t>(std::thread::hardware_concurrency(), 1); }
+
+    /**
+     * @brief run task(0), task(1), ..., task(n - 1) on a pool of threads,
+     * the first exception thrown by a task is rethrown after all threads are joined
+     * @tparam Task callable with std::size_t
+     * @param n number of tasks
+     * @param threads number of threads, tasks are run in the calling thread for no more than 1
+     * @param task task
+     */
+    template <typename Task>
+    static void run(const std::size_t &n, const std::size_t &threads, const Task &task)
+    {
+        const std::size_t m = std::min(n, threads);
+        if (m <= 1)
+        {
+            for (std::size_t k = 0; k < n; k++)
+                task(k);
+            return;
+        }
+        std::atomic<std::size_t> next(0);
+        std::exception_ptr error;
+        std::mutex lock;
+        std::vector<std::thread> pool;
+        for (std::size_t t = 0; t < m; t++)
+            pool.emplace_back([&]()
+                              {
+                                  for (std::size_t k; (k = next++) < n;)
+                                  {
+                                      try
+                                      {
+                                          task(k);
+                                      }
+                                      catch (...)
+                                      {
+                                          std::lock_guard<std::mutex> guard(lock);
+                                          if (!error)
+                                              error = std::current_exception();
+                                          next = n;
+                                      }
+                                  } });
+        for (auto &t : pool)
+            t.join();
+        if (error)
+            std::rethrow_exception(error);
+        return;
+    }
+};
+
+/**
+ * @brief
+ * bounded queue handing items from one thread to another, used for overlapping file I/O with coding,
+ * a closed queue takes no more items, while the items in it can still be taken
+ * @tparam T item type
+ */
+template <typename T>
+class HFMQueue
+{
+private:
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<T> items;
+    const std::size_t capacity;
+    bool closed;
+
+public:
+    /**
+     * @brief Construct a new HFMQueue object
+     * @param capacity number of items held at most, 2 for double buffering by default
+     */
+    explicit HFMQueue(const std::size_t &capacity = 2) : capacity(std::max<std::size_t>(capacity, 1)), closed(false) {}
+    HFMQueue(const HFMQueue &) = delete;
+    HFMQueue &operator=(const HFMQueue &) = delete;
+
+    /**
+     * @brief put an item, waiting while the queue is full
+     * @param item item
+     * @return bool false for a closed queue, the item dropped
+     */
+    bool push(T item)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]()
+                     { return closed || items.size() < capacity; });
+        if (closed)
+            return false;
+        items.emplace_back(std::move(item));
+        changed.notify_all();
+        return true;
+    }
+    /**
+     * @brief take an item, waiting while the queue is empty
+     * @return std::optional<T> std::nullopt for a closed queue with no items left
+     */
+    std::optional<T> pop()
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&]()
+                     { return closed || !items.empty(); });
+        if (items.empty())
+            return std::nullopt;
+        std::optional<T> item(std::move(items.front()));
+        items.pop_front();
+        changed.notify_all();
+        return item;
+    }
+    /** @brief close the queue, waking up all threads waiting on it */
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        changed.notify_all();
+        return;
+    }
+
+    /**
+     * @brief a thread filling or draining a HFMQueue, the queue is closed when the thread ends and before it is joined,
+     * so that neither side waits forever, whichever of them fails
+     */
+    class Stage
+    {
+    private:
+        HFMQueue &queue;
+        std::exception_ptr error;
+        std::thread thread;
+
+    public:
+        /**
+         * @brief Construct a new Stage object, running task on its own thread
+         * @tparam Task callable with no arguments
+         * @param queue HFMQueue filled or drained by task
+         * @param task task
+         */
+        template <typename Task>
+        Stage(HFMQueue &queue, Task task) : queue(queue), error(), thread([this, task]()
+                                                                        {
+                                                                            try
+                                                                            {
+                                                                                task();
+                                                                            }
+                                                                            catch (...)
+                                                                            {
+                                                                                error = std::current_exception();
+                                                                            }
+                                                                            this->queue.close(); })
+        {
+        }
+        Stage(const Stage &) = delete;
+        Stage &operator=(const Stage &) = delete;
+        /** @brief close the queue and join the thread, the exception thrown by the task is rethrown */
+        void join()
+        {
+            queue.close();
+            if (thread.joinable())
+                thread.join();
+            if (error)
+                std::rethrow_exception(std::exchange(error, nullptr));
+            return;
+        }
+        virtual ~Stage()
+        {
+            queue.close();
+            if (thread.joinable())
+                thread.join();
+        }
+    };
+};
+
+#if defined(HFM_STATS)
+/**
+ * @brief
+ * statistics of hot paths, bytes in and out, time spent and allocations made by each stage of coding, summed over all threads,
+ * compiled only with HFM_STATS defined, otherwise the HFM_STATS_* macros expand to nothing,
+ * HFM_STATS_ALLOCATED(stage) counting an allocation of a stage outside of its HFM_STATS_SCOPE without counting another call
+ */
+class HFMStats
+{
+public:
+    /** @brief stages of coding */
+    enum Stage : uint8_t
+    {
+        count,
+        build,
+        encode,
+        decode,
+        stages
+    };
+    /** @brief names of stages */
+    constexpr static std::array<const char *, stages> names{"count", "build", "encode", "decode"};
+
+    /** @brief statistics of a stage */
+    struct Record
+    {
+        std::atomic<std::size_t> calls, bytes_in, bytes_out, ns, allocations;
+    };
+
+    /** @brief statistics of all stages */
+    static std::array<Record, stages> &records() noexcept
+    {
+        static std::array<Record, stages> r{};
+        return r;
+    }
+    /** @brief reset statistics of all stages */
+    static void reset() noexcept
+    {
+        for (auto &r : records())
+            r.calls = r.bytes_in = r.bytes_out = r.ns = r.allocations = 0;
+        return;
+    }
+    /**
+     * @brief report statistics of all stages, a JSON object for each stage in a line
+     * @param o std::ostream
+     */
+    static void report(std::ostream &o)
+    {
+        for (std::size_t k = 0; k < stages; k++)
+        {
+            const Record &r = records()[k];
+            o << "{\"stage\": \"" << names[k] << "\", \"calls\": " << r.calls << ", \"bytes_in\": " << r.bytes_in
+              << ", \"bytes_out\": " << r.bytes_out << ", \"ns\": " << r.ns << ", \"allocations\": " << r.allocations << "}" << std::endl;
+        }
+        return;
+    }
+
+    /** @brief timing a call of a stage from its construction to its destruction */
+    class Scope
+    {
+    private:
+        Record &record;
+        const std::chrono::steady_clock::time_point start;
+
+    public:
+        Scope(const Stage &stage, const std::size_t &bytes_in) noexcept : record(records()[stage]), start(std::chrono::steady_clock::now())
+        {
+            record.calls++;
+            record.bytes_in += bytes_in;
+        }
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+        ~Scope() { record.ns += std::size_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count()); }
+
+        /** @brief count bytes out of the call */
+        inline void out(const std::size_t &bytes) noexcept { record.bytes_out += bytes; }
+        /** @brief count an allocation made by the call */
+        inline void allocation() noexcept { record.allocations++; }
+    };
+};
+#define HFM_STATS_SCOPE(stage, bytes_in) HFMStats::Scope hfm_stats_scope(HFMStats::stage, bytes_in)
+#define HFM_STATS_OUT(bytes) hfm_stats_scope.out(bytes)
+#define HFM_STATS_ALLOCATION() hfm_stats_scope.allocation()
+#define HFM_STATS_ALLOCATED(stage) HFMStats::records()[HFMStats::stage].allocations++
+#else
+#define HFM_STATS_SCOPE(stage, bytes_in)
+#define HFM_STATS_OUT(bytes)
+#define HFM_STATS_ALLOCATION()
+#define HFM_STATS_ALLOCATED(stage)
+#endif
+
+/**
+ * @brief
+ * CRC32C (Castagnoli) checksums of stored bytes, computed with the crc32 instructions of SSE 4.2 or ARMv8 when the CPU has them,
+ * otherwise 8 bytes at a time with tables (slicing by 8)
  */
+class HFMCRC
+{
+private:
+    /** @brief the Castagnoli polynomial, bits reflected */
+    constexpr static uint32_t polynomial = 0x82f63b78;
+    using Tables = std::array<std::array<uint32_t, 256>, 8>;
+
+    /** @brief tables of slicing by 8, tables[k][b] is the CRC of byte b followed by k zero bytes */
+    static const Tables &tables() noexcept
+    {
+        static constexpr Tables t = []()
+        {
+            Tables t{};
+            for (uint32_t b = 0; b < 256; b++)
+            {
+                uint32_t c = b;
+                for (uint8_t j = 0; j < 8; j++)
+                    c = (c >> 1) ^ ((c & 1) ? polynomial : 0);
+                t[0][b] = c;
+            }
+            for (std::size_t k = 1; k < 8; k++)
+                for (uint32_t b = 0; b < 256; b++)
+                    t[k][b] = (t[k - 1][b] >> 8) ^ t[0][t[k - 1][b] & 0xff];
+            return t;
+        }();
+        return t;
+    }
+    /**
+     * @brief CRC of bytes with tables
+     * @param c CRC register, inverted
+     * @param p bytes
+     * @param n number of bytes
+     * @return uint32_t CRC register, inverted
+     */
+    static uint32_t software(uint32_t c, const uint8_t *p, std::size_t n) noexcept
+    {
+        const Tables &t = tables();
+        for (; n >= 8; n -= 8, p += 8)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            v ^= c;
+            c = t[7][v & 0xff] ^ t[6][(v >> 8) & 0xff] ^ t[5][(v >> 16) & 0xff] ^ t[4][(v >> 24) & 0xff] ^
+                t[3][(v >> 32) & 0xff] ^ t[2][(v >> 40) & 0xff] ^ t[1][(v >> 48) & 0xff] ^ t[0][v >> 56];
+        }
+        for (; n; n--)
+            c = (c >> 8) ^ t[0][(c ^ *p++) & 0xff];
+        return c;
+    }
+    /**
+     * @brief product of polynomials a and b modulo the polynomial, bits reflected
+     * @param a polynomial, x^0 at the highest bit
+     * @param b polynomial, x^0 at the highest bit
+     * @return uint32_t
+     */
+    static uint32_t multiply(const uint32_t &a, uint32_t b) noexcept
+    {
+        uint32_t p = 0;
+        for (uint32_t m = uint32_t(1) << 31; m; m >>= 1)
+        {
+            if (a & m)
+                p ^= b;
+            b = (b >> 1) ^ ((b & 1) ? polynomial : 0);
+        }
+        return p;
+    }
+#if defined(__x86_64__) || defined(_M_X64) || defined(__ARM_FEATURE_CRC32)
+    /** @brief size of each of the 3 lanes checksummed side by side by hardware(c, p, n), a multiple of 8 */
+    constexpr static std::size_t lane = 8192;
+
+    /**
+     * @brief CRC of bytes with the crc32 instructions, see software(c, p, n),
+     * 3 * lane bytes at a time in 3 independent lanes hiding the latency of the instruction, their CRCs joined by
+     * shifting the register of a lane over the bytes of the next one, a product with x^(8 * lane)
+     */
+#if !defined(_MSC_VER) && !defined(__ARM_FEATURE_CRC32)
+    __attribute__((target("sse4.2")))
+#endif
+    static uint32_t hardware(uint32_t c, const uint8_t *p, std::size_t n) noexcept
+    {
+        static const uint32_t shift = software(uint32_t(1) << 31, std::array<uint8_t, lane>{}.data(), lane);
+        for (; n >= 3 * lane; n -= 3 * lane, p += 3 * lane)
+        {
+            uint64_t c0 = c, c1 = 0, c2 = 0;
+            for (std::size_t j = 0; j < lane; j += 8)
+            {
+                uint64_t v0, v1, v2;
+                std::memcpy(&v0, p + j, 8);
+                std::memcpy(&v1, p + lane + j, 8);
+                std::memcpy(&v2, p + 2 * lane + j, 8);
+#if defined(__ARM_FEATURE_CRC32)
+                c0 = __crc32cd(uint32_t(c0), v0);
+                c1 = __crc32cd(uint32_t(c1), v1);
+                c2 = __crc32cd(uint32_t(c2), v2);
+#else
+                c0 = _mm_crc32_u64(c0, v0);
+                c1 = _mm_crc32_u64(c1, v1);
+                c2 = _mm_crc32_u64(c2, v2);
+#endif
+            }
+            c = multiply(multiply(uint32_t(c0), shift) ^ uint32_t(c1), shift) ^ uint32_t(c2);
+        }
+        for (; n >= 8; n -= 8, p += 8)
+        {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+#if defined(__ARM_FEATURE_CRC32)
+            c = __crc32cd(c, v);
+#else
+            c = uint32_t(_mm_crc32_u64(c, v));
+#endif
+        }
+        for (; n; n--)
+#if defined(__ARM_FEATURE_CRC32)
+            c = __crc32cb(c, *p++);
+#else
+            c = _mm_crc32_u8(c, *p++);
+#endif
+        return c;
+    }
+#endif
+    /** @brief whether the CPU has the crc32 instructions */
+    static bool accelerated() noexcept
+    {
+#if defined(__ARM_FEATURE_CRC32)
+        return true;
+#elif defined(_MSC_VER) && defined(_M_X64)
+        static const bool a = []()
+        {
+            int info[4];
+            __cpuid(info, 1);
+            return bool(info[2] & (1 << 20));
+        }();
+        return a;
+#elif defined(__x86_64__)
+        static const bool a = __builtin_cpu_supports("sse4.2");
+        return a;
+#else
+        return false;
+#endif
+    }
+
+public:
+    /**
+     * @brief CRC32C of bytes following bytes checksummed before, update(update(0, a), b) being the CRC32C of a followed by b
+     * @param crc CRC32C of the bytes before, 0 for none
+     * @param p bytes
+     * @param n number of bytes
+     * @return uint32_t
+     */
+    static uint32_t update(const uint32_t &crc, const void *p, const std::size_t &n) noexcept
+    {
+#if defined(__x86_64__) || defined(_M_X64) || defined(__ARM_FEATURE_CRC32)
+        if (accelerated())
+            return ~hardware(~crc, (const uint8_t *)(p), n);
+#endif
+        return ~software(~crc, (const uint8_t *)(p), n);
+    }
+    /**
+     * @brief CRC32C of bytes
+     * @param p bytes
+     * @param n number of bytes
+     * @return uint32_t
+     */
+    static inline uint32_t compute(const void *p, const std::size_t &n) noexcept { return update(0, p, n); }
+};
 
 /**
  * @brief
- * Huffman tree, containing a huffman tree (stored in binary tree) and code (for each character)
+ * Huffman tree, containing a huffman tree (stored in a flat array of Nodes) and code (for each character)
  */
 class HFMTree
 {
 public:
     class Counter;
     friend class HFMString;
+    /** @brief number of characters, every byte is a character */
+    constexpr static uint16_t alphabet = 256;
+
+    friend class HFMStream;
+    friend class HFMView;
+    friend class HFMDictionary;
+    friend class HFMContext;
+    template <std::array<uint8_t, alphabet> Lengths>
+    friend class HFMFixed;
+    friend class HFMBench;
 
 private:
-    class Node;
-    using Tree = Node *;
-    class Weighted_Node;
-    using Heap = std::vector<Weighted_Node>;
-    class Code;
+    struct Node;
+    class Tree;
+    struct Weighted_Node;
+    using Queue = std::array<Weighted_Node, alphabet>;
+    struct Code;
+    /** @brief helper type for HFMTree::code, codes of all characters stored inline, no allocation made */
+    using Codes = std::array<Code, alphabet>;
+    class Table;
 
-    Tree tree;
-    std::vector<Code> code;
+    /** @brief helper class for HFMTree::code, a code stored as an integer (first bit at the highest place) and its length */
+    struct Code
+    {
+        /** @brief maximum length of a Code, a Code always fits in a 64-bit accumulator holding 7 pending bits */
+        constexpr static uint8_t max_length = 57;
 
-private:
-    /** @brief helper class for HFMTree::tree, storing a huffman tree in a binary tree */
-    class Node
+        /** @brief bits of the code, the lowest Code::length bits in use */
+        uint64_t bits;
+        /** @brief length of the code in bits */
+        uint8_t length;
+
+        inline std::size_t size() const noexcept { return length; }
+        inline bool operator[](std::size_t index) const noexcept { return (bits >> (length - 1 - index)) & 1; }
+    };
+
+    /** @brief helper class for HFMTree::tree, a Node of the huffman tree, children are indexed in Tree::nodes */
+    struct Node
     {
-    public:
-        /** @brief left child */
-        Node *left;
-        /** @brief right child */
-        Node *right;
+        /** @brief child index for leaf Nodes */
+        constexpr static uint16_t none = 0xffff;
+
+        /** @brief index of left child, Node::none for leaf Nodes */
+        uint16_t left;
+        /** @brief index of right child, Node::none for leaf Nodes */
+        uint16_t right;
         /** @brief value, EOF for non-leaf Nodes, corresponding character for leaf Nodes */
         char value;
 
-        /** @brief default constructor */
-        Node() : left(nullptr), right(nullptr), value(EOF) {}
-        /** @brief Copy Constructor, copying the whole tree */
-        Node(const Node &other) = delete;
-        /** @brief Move Constructor */
-        Node(Node &&other) : left(other.left), right(other.right), value(other.value)
-        {
-            other.left = nullptr;
-            other.right = nullptr;
-        }
+        inline bool is_leaf() const noexcept { return left == none; }
+    };
+    /** @brief helper class for HFMTree::tree, storing a huffman tree in one contiguous array of Nodes, trivially copyable */
+    class Tree
+    {
+    public:
+        /** @brief maximum number of Nodes, a full binary tree with HFMTree::alphabet leaves */
+        constexpr static uint16_t capacity = 2 * alphabet - 1;
+
+        /** @brief Nodes, [0, size) in use */
+        std::array<Node, capacity> nodes;
+        /** @brief number of Nodes, 0 for an empty tree */
+        uint16_t size;
+        /** @brief index of the root Node */
+        uint16_t root;
+
+        Tree() : nodes(), size(0), root(Node::none) {}
 
         /**
-         * @brief Construct a new Node object (leaf Node) with a char
-         * @param v const char &
-         */
-        Node(const char &v) : left(nullptr), right(nullptr), value(v) {}
-        /**
-         * @brief Construct a new Node object with 2 sub-trees
-         * @param l left sub-tree
-         * @param r right sub-tree
+         * @brief add a Node
+         * @param l index of left child, Node::none for leaf Nodes
+         * @param r index of right child, Node::none for leaf Nodes
          * @param v value, defaults for EOF
+         * @return uint16_t index of the new Node
          */
-        Node(Tree l, Tree r, const char &v = EOF) : left(l), right(r), value(v) {}
+        uint16_t add(const uint16_t &l, const uint16_t &r, const char &v = EOF)
+        {
+            if (size == capacity)
+                throw std::runtime_error("too many nodes passed to class HFMTree.");
+            nodes[size] = Node{l, r, v};
+            return size++;
+        }
+        inline bool empty() const noexcept { return !size; }
+        inline const Node &operator[](const uint16_t &index) const noexcept { return nodes[index]; }
+        inline Node &operator[](const uint16_t &index) noexcept { return nodes[index]; }
+    };
 
-        /** @brief Destructor. Destroy the Node object only, use HFMTree::destroy_tree(Tree t) instead to destroy the whole tree */
-        virtual ~Node() = default;
+    Tree tree;
+    Codes code;
+    /** @brief whether HFMTree::code are canonical codes, in which case HFMTree::tree is not built */
+    bool canonical;
 
-        // Node &operator=(const Node &other) = default;
-        Node &operator=(Node &&other) = default;
-    };
     /**
      * @brief helper function for std::vector<uint8_t> sequence()
      * @param v storing result, typed std::vector<uint8_t>&
-     * @param t Tree
+     * @param tree Tree
+     * @param n index of current Node
      */
-    static void _sequence(std::vector<uint8_t> &v, Tree t)
+    static void _sequence(std::vector<uint8_t> &v, const Tree &tree, const uint16_t &n)
     {
+        const Node &t = tree[n];
         v.emplace_back(0b10000000);
-        if (t->left)
+        if (!t.is_leaf())
         {
-            _sequence(v, t->left);
-            v.emplace_back(uint8_t(t->value));
-            _sequence(v, t->right);
+            _sequence(v, tree, t.left);
+            v.emplace_back(uint8_t(t.value));
+            _sequence(v, tree, t.right);
         }
         else
-            v.emplace_back(t->value);
+            v.emplace_back(t.value);
         v.emplace_back(0b10000001);
         return;
     }
@@ -103,477 +682,4932 @@ private:
     std::vector<uint8_t> sequence() const
     {
         std::vector<uint8_t> v(0);
-        _sequence(v, tree);
+        const Tree t = tree.empty() ? build_tree(code) : tree;
+        _sequence(v, t, t.root);
         return v;
     }
 
-    /** @brief helper class for HFMTree::tree, storing a huffman tree in a binary tree with weight*/
-    class Weighted_Node : public Node
+    /** @brief helper class for building HFMTree::tree, a Node in a HFMTree::Queue with the weight of its sub-tree */
+    struct Weighted_Node
     {
-    public:
-        /** @brief weight of the whole tree */
+        /** @brief weight of the whole sub-tree */
         std::size_t weight;
+        /** @brief index of the Node in Tree::nodes */
+        uint16_t node;
+
+        /** @brief operator< comparing 2 Nodes by weight, then by index for a deterministic order */
+        friend inline bool operator<(const Weighted_Node &a, const Weighted_Node &b) { return a.weight != b.weight ? a.weight < b.weight : a.node < b.node; }
+    };
+
+    /**
+     * @brief helper class for HFMTree::decode, a multi-level lookup table built from HFMTree::code
+     * the primary table is indexed by the next Table::width bits of code and may resolve 2 characters at once,
+     * codes longer than that are resolved through secondary tables, stored behind the primary one in Table::entries
+     * the table is built in a scratch arena on the stack, then copied into a single block from a std::pmr::memory_resource
+     * for short codes, Table::runs resolves up to 4 characters per lookup of the same bits, stored with one 4-byte write
+     */
+    class Table
+    {
+    public:
+        /** @brief maximum width of a single table in bits */
+        constexpr static uint8_t bits = 11;
+
+        /**
+         * @brief entry of a Table
+         * characters: value holds 1 or 2 characters (the first one in the low byte), length the bits taken by the first one,
+         *             total the bits taken by all of them (total == length for a single character)
+         * links:      length is 0, value indexes Table::links, total is the width of the linked table in bits (0 for invalid codes)
+         */
+        struct Entry
+        {
+            uint16_t value;
+            uint8_t length;
+            uint8_t total;
+        };
+        /**
+         * @brief entry of Table::runs
+         * value holds count characters in order, total the bits taken by all of them,
+         * count is 0 for codes longer than Table::width, left to Table::entries
+         */
+        struct alignas(8) Run
+        {
+            std::array<char, 4> value;
+            uint8_t count;
+            uint8_t total;
+        };
+
+        /** @brief width of the primary table in bits */
+        uint8_t width;
+        /** @brief length of the shortest code */
+        uint8_t shortest;
+        /** @brief primary table followed by all secondary tables */
+        std::span<Entry> entries;
+        /** @brief offsets of secondary tables in Table::entries */
+        std::span<std::size_t> links;
+        /** @brief primary table resolving up to 4 characters at once, built for paired tables of short codes only, empty otherwise */
+        std::span<Run> runs;
+
+        Table() noexcept : width(0), shortest(0), memory(std::pmr::get_default_resource()), block(nullptr), bytes(0) {}
+        /**
+         * @brief Construct a new Table object
+         * @param code HFMTree::code
+         * @param resource memory resource the block holding Table::links and Table::entries is allocated from
+         * @param paired whether entries of the primary table resolve 2 characters at once, see pair(s), left to the caller otherwise
+         */
+        Table(const Codes &code, std::pmr::memory_resource *resource = std::pmr::get_default_resource(), const bool &paired = true)
+            : width(0), shortest(0), memory(resource), block(nullptr), bytes(0)
+        {
+            HFM_STATS_SCOPE(build, 0);
+            std::array<std::byte, scratch> buffer;
+            std::pmr::monotonic_buffer_resource arena(buffer.data(), buffer.size(), resource);
+            Scratch s{Buffer<Entry>{&arena}, Buffer<std::size_t>{&arena}};
+            std::pmr::vector<uint8_t> symbols(&arena);
+            std::size_t longest = 0;
+            for (std::size_t i = 0; i < code.size(); i++)
+                if (code[i].size())
+                {
+                    symbols.emplace_back(uint8_t(i));
+                    longest = std::max(longest, code[i].size());
+                    shortest = uint8_t((shortest && shortest < code[i].size()) ? shortest : code[i].size());
+                }
+            if (symbols.empty())
+                return;
+            // room for a 2nd character after the longest codes, as long as the table stays small
+            width = uint8_t(std::min<std::size_t>(longest << 1, bits));
+            s.entries.append(std::size_t(1) << width, Entry{0, 0, 0});
+            fill(s, code, symbols, 0, 0, width);
+            if (paired)
+                pair(s);
+            HFM_STATS_ALLOCATION();
+            // worth it when runs of 3 characters fit in the primary table, e.g. skewed text coded in 1 to 3 bits
+            allocate(s.links.size, s.entries.size, (paired && shortest * 3 <= width) ? (std::size_t(1) << width) : 0);
+            std::copy_n(s.links.data, s.links.size, links.data());
+            std::copy_n(s.entries.data, s.entries.size, entries.data());
+            if (!runs.empty())
+                run();
+        }
+        /** @brief copies allocate from the default memory resource */
+        Table(const Table &other) : width(other.width), shortest(other.shortest), memory(std::pmr::get_default_resource()), block(nullptr), bytes(0)
+        {
+            allocate(other.links.size(), other.entries.size(), other.runs.size());
+            if (bytes)
+                std::memcpy(block, other.block, bytes);
+        }
+        Table(Table &&other) noexcept
+            : width(other.width), shortest(other.shortest), entries(other.entries), links(other.links), runs(other.runs),
+              memory(other.memory), block(other.block), bytes(other.bytes)
+        {
+            other.release(false);
+        }
+        Table &operator=(const Table &other) { return (this != &other) ? (*this = Table(other)) : *this; }
+        Table &operator=(Table &&other) noexcept
+        {
+            if (this == &other)
+                return *this;
+            release(true);
+            entries = other.entries, links = other.links, runs = other.runs;
+            width = other.width, shortest = other.shortest;
+            memory = other.memory, block = other.block, bytes = other.bytes;
+            other.release(false);
+            return *this;
+        }
+        ~Table() { release(true); }
+
+        /** @brief the memory resource the block holding Table::links and Table::entries is allocated from */
+        inline std::pmr::memory_resource *resource() const noexcept { return memory; }
+
+    private:
+        /** @brief size of the scratch arena on the stack in bytes, covering most tables, larger ones fall back to the memory resource */
+        constexpr static std::size_t scratch = 32768;
 
-        /** @brief default constructor */
-        Weighted_Node() : Node(), weight(0) {}
+        /** @brief memory resource Table::block is allocated from */
+        std::pmr::memory_resource *memory;
+        /** @brief the single allocation holding Table::links, Table::entries and Table::runs in order, nullptr for empty tables */
+        std::byte *block;
+        /** @brief size of Table::block in bytes */
+        std::size_t bytes;
 
-        /** @brief Copy Constructor, copying the whole tree */
-        Weighted_Node(const Weighted_Node &other) = delete;
-        /** @brief Move Constructor */
-        Weighted_Node(Weighted_Node &&other) : weight(other.weight)
+        /**
+         * @brief a growable array of trivially copyable T in the scratch arena, storage outgrown is released with the arena
+         * @tparam T element type
+         */
+        template <typename T>
+        struct Buffer
+        {
+            std::pmr::memory_resource *arena;
+            T *data = nullptr;
+            std::size_t size = 0, capacity = 0;
+
+            /**
+             * @brief append n copies of value
+             * @return std::size_t offset of the first one appended
+             */
+            std::size_t append(const std::size_t &n, const T &value)
+            {
+                if (size + n > capacity)
+                {
+                    capacity = std::max(size + n, capacity << 1);
+                    T *p = static_cast<T *>(arena->allocate(capacity * sizeof(T), alignof(T)));
+                    if (size)
+                        std::memcpy(p, data, size * sizeof(T));
+                    data = p;
+                }
+                std::fill_n(data + size, n, value);
+                size += n;
+                return size - n;
+            }
+        };
+        /** @brief a Table under construction, allocated from the scratch arena */
+        struct Scratch
+        {
+            Buffer<Entry> entries;
+            Buffer<std::size_t> links;
+        };
+
+        /**
+         * @brief allocate Table::block from Table::memory for nl links, ne entries and nr runs
+         * @param nl number of links
+         * @param ne number of entries
+         * @param nr number of runs
+         */
+        void allocate(const std::size_t &nl, const std::size_t &ne, const std::size_t &nr)
+        {
+            bytes = nl * sizeof(std::size_t) + ne * sizeof(Entry) + nr * sizeof(Run);
+            if (!bytes)
+                return;
+            block = static_cast<std::byte *>(memory->allocate(bytes, alignof(std::size_t)));
+            links = std::span<std::size_t>(reinterpret_cast<std::size_t *>(block), nl);
+            entries = std::span<Entry>(reinterpret_cast<Entry *>(block + nl * sizeof(std::size_t)), ne);
+            runs = std::span<Run>(reinterpret_cast<Run *>(block + nl * sizeof(std::size_t) + ne * sizeof(Entry)), nr);
+            return;
+        }
+        /**
+         * @brief release Table::block
+         * @param free whether to return it to Table::memory, false when it has been moved to another Table
+         */
+        void release(const bool &free) noexcept
         {
-            value = other.value;
-            left = other.left;
-            right = other.right;
-            other.left = nullptr;
-            other.right = nullptr;
+            if (free && block)
+                memory->deallocate(block, bytes, alignof(std::size_t));
+            entries = std::span<Entry>(), links = std::span<std::size_t>(), runs = std::span<Run>();
+            block = nullptr, bytes = 0;
+            return;
         }
 
         /**
-         * @brief Construct a new Node object (leaf Node) with a char
-         * @param v char
+         * @brief read bits [from, from + n) of a code as an integer, bits out of the code are read as 0
+         * @param c code
+         * @param from first bit
+         * @param n number of bits, no more than Table::bits
+         * @return std::size_t
          */
-        Weighted_Node(const char &v, const std::size_t &w = 0) : Node(v), weight(w) {}
+        static std::size_t slice(const Code &c, const std::size_t &from, const std::size_t &n)
+        {
+            const uint64_t mask = (uint64_t(1) << n) - 1;
+            if (from >= c.length)
+                return 0;
+            if (from + n <= c.length)
+                return (c.bits >> (c.length - from - n)) & mask;
+            return (c.bits << (from + n - c.length)) & mask;
+        }
+        /**
+         * @brief fill a table of w bits at offset, with characters whose codes share the first depth bits
+         * @param s the Table under construction
+         * @param code HFMTree::code
+         * @param symbols characters to be placed in this table
+         * @param offset offset of the table in Table::entries
+         * @param depth bits already consumed before reaching this table
+         * @param w width of the table
+         */
+        static void fill(Scratch &s, const Codes &code, const std::pmr::vector<uint8_t> &symbols,
+                         const std::size_t offset, const std::size_t depth, const uint8_t w)
+        {
+            std::pmr::vector<std::pair<std::size_t, uint8_t>> longer(s.entries.arena);
+            for (const auto &c : symbols)
+            {
+                const std::size_t l = code[c].size() - depth;
+                if (l <= w)
+                    std::fill_n(s.entries.data + offset + (slice(code[c], depth, l) << (w - l)),
+                                std::size_t(1) << (w - l),
+                                Entry{c, uint8_t(l), uint8_t(l)});
+                else
+                    longer.emplace_back(slice(code[c], depth, w), c);
+            }
+            std::sort(longer.begin(), longer.end());
+            for (auto i = longer.begin(); i != longer.end();)
+            {
+                std::pmr::vector<uint8_t> group(s.entries.arena);
+                std::size_t longest = 0;
+                auto j = i;
+                for (; j != longer.end() && j->first == i->first; j++)
+                {
+                    group.emplace_back(j->second);
+                    longest = std::max(longest, code[j->second].size());
+                }
+                const uint8_t sub = uint8_t(std::min<std::size_t>(longest - depth - w, bits));
+                s.entries.data[offset + i->first] = Entry{uint16_t(s.links.size), 0, sub};
+                const std::size_t linked = s.entries.append(std::size_t(1) << sub, Entry{0, 0, 0});
+                s.links.append(1, linked);
+                fill(s, code, group, linked, depth + w, sub);
+                i = j;
+            }
+            return;
+        }
+        /**
+         * @brief let entries of the primary table resolve a 2nd character when its code fits in the remaining bits
+         * @param s the Table under construction
+         */
+        void pair(Scratch &s) const
+        {
+            const std::size_t size = std::size_t(1) << width, mask = size - 1;
+            // done in place, pairing keeps the first character and its length of an entry
+            for (std::size_t i = 0; i < size; i++)
+            {
+                const Entry a = s.entries.data[i];
+                if (!a.length || a.length >= width)
+                    continue;
+                const Entry &b = s.entries.data[(i << a.length) & mask];
+                if (b.length && b.length <= width - a.length)
+                    s.entries.data[i] = Entry{uint16_t(a.value | ((b.value & 0xff) << 8)), a.length, uint8_t(a.length + b.length)};
+            }
+            return;
+        }
+        /** @brief fill Table::runs from the paired primary table, chaining 2 entries as long as their codes fit in the remaining bits */
+        void run()
+        {
+            const std::size_t size = std::size_t(1) << width, mask = size - 1;
+            for (std::size_t i = 0; i < size; i++)
+            {
+                const Entry &a = entries[i];
+                Run &r = runs[i];
+                r = Run{{char(a.value & 0xff), char(a.value >> 8)}, uint8_t(a.length ? 1 + (a.total != a.length) : 0), a.total};
+                if (!a.length || a.total >= width)
+                    continue;
+                // bits of code beyond a.total read as 0, so that only codes fitting in width - a.total bits are taken
+                const Entry &b = entries[(i << a.total) & mask];
+                if (b.length && b.total <= width - a.total)
+                {
+                    r.value[r.count] = char(b.value & 0xff), r.value[r.count + 1] = char(b.value >> 8);
+                    r.count = uint8_t(r.count + 1 + (b.total != b.length)), r.total = uint8_t(r.total + b.total);
+                }
+                else if (b.length && b.length <= width - a.total)
+                {
+                    r.value[r.count] = char(b.value & 0xff);
+                    r.count++, r.total = uint8_t(r.total + b.length);
+                }
+            }
+            return;
+        }
+    };
+    Table table;
+
+    /**
+     * @brief building a huffman tree using a std::string
+     * @param s source text
+     * @return Tree
+     */
+    static Tree build_tree(const std::string &s) { return build_tree(Counter(s)); }
+    /**
+     * @brief building a huffman tree using a Counter object, with the two-queue method:
+     * leaves are sorted by weight once, merged nodes are created in order of weight, so that
+     * the 2 lightest nodes are always at the front of the 2 queues, no allocation made
+     * @param counter counting characters, typed HFMTree::Counter
+     * @return Tree
+     */
+    static Tree build_tree(const Counter &counter)
+    {
+        HFM_STATS_SCOPE(build, 0);
+        Tree tree;
+        Queue leaves, merged;
+        std::size_t n = 0;
+        for (std::size_t i = 0; i < counter.size(); i++)
+            if (counter[i])
+                leaves[n++] = Weighted_Node{counter[i], tree.add(Node::none, Node::none, char(i))};
+        if (n == 0)
+            throw std::runtime_error("empty text passed to class HFMTree.");
+        if (n == 1)
+            throw std::runtime_error("single-character-composed text passed to class HFMTree.");
+        std::sort(leaves.begin(), leaves.begin() + n);
+        std::size_t l = 0, m = 0, created = 0;
+        // leaves are taken first on ties, keeping the tree shallow
+        const auto take = [&]() -> const Weighted_Node &
+        { return (l < n && (m == created || leaves[l].weight <= merged[m].weight)) ? leaves[l++] : merged[m++]; };
+        while (created < n - 1)
+        {
+            const Weighted_Node left = take();
+            const Weighted_Node right = take();
+            merged[created++] = Weighted_Node{left.weight + right.weight, tree.add(left.node, right.node)};
+        }
+        tree.root = merged[created - 1].node;
+        return tree;
+    }
+    /**
+     * @brief building a huffman tree using HFMTree::code
+     * @param code HFMTree::code
+     * @return Tree
+     */
+    static Tree build_tree(const Codes &code)
+    {
+        Tree tree;
+        tree.root = tree.add(Node::none, Node::none);
+        for (std::size_t i = 0; i < code.size(); i++)
+        {
+            uint16_t t = tree.root;
+            for (std::size_t j = 0; j < code[i].size(); j++)
+            {
+                const uint16_t next = code[i][j] ? tree[t].right : tree[t].left;
+                if (next != Node::none)
+                    t = next;
+                else
+                {
+                    const uint16_t n = tree.add(Node::none, Node::none);
+                    (code[i][j] ? tree[t].right : tree[t].left) = n;
+                    t = n;
+                }
+            }
+            if (code[i].size())
+                tree[t].value = char(i);
+        }
+        return tree;
+    }
+    /** @brief maximum size of a sequenced tree, 3 bytes for each Node of a full tree, see sequence() */
+    constexpr static std::size_t max_sequence = 3 * std::size_t(Tree::capacity);
+    /**
+     * @brief helper function for build_tree(begin, end), adding Nodes of a sequenced tree at p to a tree,
+     * every bracket is checked before it is read, so that a corrupted sequence never leads reading past its end
+     * @tparam RandomAccessIterator
+     * @param tree Tree to be added to
+     * @param p iterator pointing to [0b10000000] of the sequence, moved past its [0b10000001]
+     * @param end end of the whole sequence
+     * @param seen characters of leaves added so far
+     * @param depth depth of the Node
+     * @return uint16_t index of the root Node of the sequence
+     */
+    template <typename RandomAccessIterator>
+    static uint16_t _build_tree(Tree &tree, RandomAccessIterator &p, const RandomAccessIterator &end, std::bitset<alphabet> &seen,
+                                const uint8_t &depth)
+    {
+        if (end - p < 3 || uint8_t(*p) != 0b10000000)
+            throw std::runtime_error("invalid sequenced tree passed to class HFMTree.");
+        if (depth > Code::max_length)
+            throw std::runtime_error("too long codes generated in class HFMTree.");
+        uint16_t n;
+        if (uint8_t(*++p) == 0b10000000)
+        {
+            const uint16_t left = _build_tree(tree, p, end, seen, depth + 1);
+            if (p == end)
+                throw std::runtime_error("invalid sequenced tree passed to class HFMTree.");
+            const char value = char(*p++);
+            const uint16_t right = _build_tree(tree, p, end, seen, depth + 1);
+            n = tree.add(left, right, value);
+        }
+        else
+        {
+            const uint8_t value = uint8_t(*p++);
+            if (value == 0b10000001 || seen[value])
+                throw std::runtime_error("invalid sequenced tree passed to class HFMTree.");
+            seen[value] = true;
+            n = tree.add(Node::none, Node::none, char(value));
+        }
+        if (p == end || uint8_t(*p) != 0b10000001)
+            throw std::runtime_error("invalid sequenced tree passed to class HFMTree.");
+        p++;
+        return n;
+    }
+    /**
+     * @brief build a huffman tree using a sequenced tree [begin, end)
+     * @tparam T iterator type
+     * @param begin begin of the sequence
+     * @param end end of the sequence, right after the [0b10000001] of the root
+     * @return Tree
+     */
+    template <typename RandomAccessIterator>
+    static Tree build_tree(const RandomAccessIterator &begin, const RandomAccessIterator &end)
+    {
+        Tree tree;
+        std::bitset<alphabet> seen;
+        RandomAccessIterator p = begin;
+        tree.root = _build_tree(tree, p, end, seen, 0);
+        if (p != end)
+            throw std::runtime_error("invalid sequenced tree passed to class HFMTree.");
+        if (tree[tree.root].is_leaf())
+            throw std::runtime_error("less than 2 characters passed to class HFMTree.");
+        return tree;
+    }
+
+    /**
+     * @brief helper function for static void generate_code(Tree tree, Code code[])
+     * @param tree HFMTree::tree
+     * @param n index of current Node
+     * @param code HFMTree::code
+     * @param path recording current path, first step at the highest place, typed uint64_t
+     * @param depth recorcing current depth (also path length), typed uint8_t
+     */
+    static void _generate_code(const Tree &tree, const uint16_t &n, Codes &code, const uint64_t &path, const uint8_t &depth)
+    {
+        if (tree[n].is_leaf())
+        {
+            if (depth > Code::max_length)
+                throw std::runtime_error("too long codes generated in class HFMTree.");
+            code[uint8_t(tree[n].value)] = Code{path, depth};
+        }
+        else
+        {
+            _generate_code(tree, tree[n].right, code, (path << 1) | 1, depth + 1);
+            _generate_code(tree, tree[n].left, code, path << 1, depth + 1);
+        }
+        return;
+    }
+    /**
+     * @brief helper function for HFMTree(const std::string &s), generating HFMTree::code
+     *
+     * @param tree HFMTree::tree
+     */
+    static Codes generate_code(const Tree &tree)
+    {
+        HFM_STATS_SCOPE(build, 0);
+        Codes code{};
+        _generate_code(tree, tree.root, code, 0, 0);
+        return code;
+    }
+    /**
+     * @brief optimal code lengths no longer than max_length, using the package-merge algorithm:
+     * every character is a coin of its weight at each of the max_length levels, coins of a level are paired into
+     * packages for the level above, and the 2n - 2 lightest items of the top level are taken, a character's code length
+     * being the number of its coins taken
+     * @param counter counting characters, typed HFMTree::Counter
+     * @param max_length maximum code length, no more than Code::max_length
+     * @return std::vector<uint8_t> code length of each character, 0 for absent characters
+     */
+    static std::vector<uint8_t> limit_lengths(const Counter &counter, const uint8_t &max_length)
+    {
+        /** @brief a coin of a character, or a package of items left and left + 1 from the level below */
+        struct Item
+        {
+            std::size_t weight;
+            int16_t symbol;
+            uint32_t left;
+        };
+        std::vector<Item> leaves;
+        for (std::size_t i = 0; i < counter.size(); i++)
+            if (counter[i])
+                leaves.emplace_back(Item{counter[i], int16_t(i), 0});
+        if (leaves.size() == 0)
+            throw std::runtime_error("empty text passed to class HFMTree.");
+        if (leaves.size() == 1)
+            throw std::runtime_error("single-character-composed text passed to class HFMTree.");
+        if (max_length > Code::max_length || (std::size_t(1) << std::min<uint8_t>(max_length, 63)) < leaves.size())
+            throw std::invalid_argument("invalid maximum code length passed to class HFMTree.");
+        std::stable_sort(leaves.begin(), leaves.end(),
+                         [](const Item &a, const Item &b)
+                         { return a.weight < b.weight; });
+        std::vector<std::vector<Item>> levels{leaves};
+        for (uint8_t d = 1; d < max_length; d++)
+        {
+            const auto &below = levels.back();
+            std::vector<Item> level;
+            level.reserve(leaves.size() + (below.size() >> 1));
+            auto leaf = leaves.begin();
+            for (std::size_t k = 0; k + 1 < below.size(); k += 2)
+            {
+                const std::size_t weight = below[k].weight + below[k + 1].weight;
+                for (; leaf != leaves.end() && leaf->weight <= weight; leaf++)
+                    level.emplace_back(*leaf);
+                level.emplace_back(Item{weight, -1, uint32_t(k)});
+            }
+            level.insert(level.end(), leaf, leaves.end());
+            levels.emplace_back(std::move(level));
+        }
+        std::vector<uint8_t> lengths(alphabet);
+        // items taken at each level, the 2n - 2 lightest at the top, then the ones packed into them below
+        std::vector<std::size_t> taken{2 * leaves.size() - 2};
+        for (std::size_t d = levels.size(); d-- > 0;)
+        {
+            std::size_t packed = 0;
+            for (std::size_t k = 0; k < taken.back(); k++)
+            {
+                const Item &item = levels[d][k];
+                if (item.symbol >= 0)
+                    lengths[item.symbol]++;
+                else
+                    packed = std::max<std::size_t>(packed, item.left + 2);
+            }
+            taken.emplace_back(packed);
+        }
+        return lengths;
+    }
+    /**
+     * @brief generating canonical HFMTree::code from code lengths,
+     * codes are assigned in ascending order of (length, character), each being the previous one plus 1
+     * @param lengths code length of each character, 0 for absent characters
+     * @return Codes
+     */
+    static Codes generate_code(const std::vector<uint8_t> &lengths)
+    {
+        HFM_STATS_SCOPE(build, 0);
+        if (lengths.size() > alphabet)
+            throw std::invalid_argument("too many code lengths passed to class HFMTree.");
+        std::vector<uint8_t> order;
+        for (std::size_t i = 0; i < lengths.size(); i++)
+            if (lengths[i])
+                order.emplace_back(uint8_t(i));
+        if (order.size() < 2)
+            throw std::runtime_error("less than 2 characters passed to class HFMTree.");
+        std::stable_sort(order.begin(), order.end(),
+                         [&](const uint8_t &a, const uint8_t &b)
+                         { return lengths[a] < lengths[b]; });
+        Codes code{};
+        uint64_t next = 0;
+        uint8_t last = 0;
+        for (std::size_t k = 0; k < order.size(); k++)
+        {
+            const uint8_t &l = lengths[order[k]];
+            if (l > Code::max_length)
+                throw std::runtime_error("too long code lengths passed to class HFMTree.");
+            if (k)
+                next++;
+            next <<= l - last;
+            if (next >> l)
+                throw std::runtime_error("over-subscribed code lengths passed to class HFMTree.");
+            code[order[k]] = Code{next, l};
+            last = l;
+        }
+        if (next != (uint64_t(1) << last) - 1)
+            throw std::runtime_error("incomplete code lengths passed to class HFMTree.");
+        return code;
+    }
+
+    /**
+     * @brief store 8 bytes in big-endian order, helper function for encode(const std::string_view &string)
+     * @param p destination
+     * @param v value
+     */
+    static inline void store(uint8_t *p, const uint64_t &v) noexcept
+    {
+        for (uint8_t i = 0; i < sizeof(uint64_t); i++)
+            p[i] = uint8_t(v >> (56 - (i << 3)));
+    }
+    /**
+     * @brief load 8 bytes in big-endian order, helper function for decode(begin, end, l2, buffer, capacity)
+     * @param p source, no alignment required
+     * @return uint64_t
+     */
+    static inline uint64_t load(const uint8_t *p) noexcept
+    {
+        // spelled out, so that it is compiled into a single load and a byte swap
+        return (uint64_t(p[0]) << 56) | (uint64_t(p[1]) << 48) | (uint64_t(p[2]) << 40) | (uint64_t(p[3]) << 32) |
+               (uint64_t(p[4]) << 24) | (uint64_t(p[5]) << 16) | (uint64_t(p[6]) << 8) | uint64_t(p[7]);
+    }
+
+    /**
+     * @brief encode a string into a buffer with codes, helper function for encode(string, out) and HFMFixed::encode
+     * @tparam Counting whether characters are counted into histogram as well, see encode(string, out, counter)
+     * @param code codes of all characters
+     * @param string string to be encoded
+     * @param out destination, (sum of code lengths + 7) / 8 bytes written
+     * @param histogram Counter::lanes histograms, consecutive characters counted into them in turn, as Counter::count
+     * @return uint8_t* end of the code written
+     */
+    template <bool Counting = false>
+    static uint8_t *_encode(const Codes &code, const std::string_view &string, uint8_t *out,
+                            std::array<std::size_t, alphabet> *histogram = nullptr) noexcept
+    {
+        uint64_t cache = 0;
+        uint8_t used = 0;
+        for (std::size_t k = 0; k < string.size(); k++)
+        {
+            const uint8_t i = uint8_t(string[k]);
+            if constexpr (Counting)
+                histogram[k % Counter::lanes][i]++;
+            const Code &c = code[i];
+            if (used + c.length < 64)
+            {
+                cache |= c.bits << (64 - used - c.length);
+                used += c.length;
+            }
+            else
+            {
+                const uint8_t rest = used + c.length - 64;
+                cache |= c.bits >> rest;
+                store(out, cache);
+                out += sizeof(uint64_t);
+                cache = rest ? c.bits << (64 - rest) : 0;
+                used = rest;
+            }
+        }
+        for (; used; used = (used > 8) ? used - 8 : 0, cache <<= 8)
+            *out++ = uint8_t(cache >> 56);
+        return out;
+    }
+    /**
+     * @brief bit-reader over a stream of code, decoding into a buffer, see decode(begin, end, l2, buffer, capacity)
+     * @tparam RandomAccessIterator
+     */
+    template <typename RandomAccessIterator>
+    struct Reader
+    {
+        RandomAccessIterator i, end;
+        // the next bits of code are kept at the top of window, avail of them are valid
+        uint64_t window;
+        uint8_t avail;
+        std::size_t count, l2;
+        char *out, *last;
+
+        Reader(const RandomAccessIterator &begin, const RandomAccessIterator &end, const std::size_t &l2, char *buffer, const std::size_t &capacity)
+            : i(begin), end(end), window(0), avail(0), count(0), l2(l2), out(buffer), last(buffer + capacity) {}
+
+        /** @brief refill the window byte by byte, bytes out of the code are read as 0, with one 8-byte load for code in memory */
+        inline void refill()
+        {
+            if constexpr (std::is_same_v<RandomAccessIterator, const uint8_t *>)
+                if (end - i >= 8)
+                {
+                    // bits beyond avail are the next bits of code as well, as in fast(r)
+                    window |= load(i) >> avail;
+                    i += (63 - avail) >> 3;
+                    avail |= 56;
+                    return;
+                }
+            for (; avail <= 56; avail += 8)
+                window |= uint64_t(i != end ? uint8_t(*i++) : 0) << (56 - avail);
+        }
+        /**
+         * @brief drop bits from the window
+         * @param n number of bits
+         */
+        inline void consume(const uint8_t &n) noexcept
+        {
+            window <<= n;
+            avail -= n;
+            count += n;
+        }
+        /** @brief whether the code or the buffer has been used up */
+        inline bool done() const noexcept { return count >= l2 || out == last; }
+    };
+    /**
+     * @brief careful path of decoding, a character (or two) at a time, resolving codes longer than HFMTree::Table::width
+     * @tparam RandomAccessIterator
+     * @param r Reader
+     * @return bool false when the code ends
+     */
+    template <typename RandomAccessIterator>
+    bool step(Reader<RandomAccessIterator> &r) const
+    {
+        r.refill();
+        Table::Entry e = table.entries[r.window >> (64 - table.width)];
+        uint8_t w = table.width;
+        while (!e.length)
+        {
+            if (!e.total)
+                throw std::runtime_error("invalid code passed to HFMTree::decode.");
+            r.consume(w);
+            r.refill();
+            w = e.total;
+            e = table.entries[table.links[e.value] + (r.window >> (64 - w))];
+        }
+        if (e.total != e.length && r.count + e.total <= r.l2 && r.last - r.out >= 2)
+        {
+            *r.out++ = char(e.value & 0xff);
+            *r.out++ = char(e.value >> 8);
+            r.consume(e.total);
+        }
+        else if (r.count + e.length <= r.l2)
+        {
+            *r.out++ = char(e.value & 0xff);
+            r.consume(e.length);
+        }
+        else
+            return false;
+        return true;
+    }
+    /**
+     * @brief fast path of decoding N streams of code in memory in one loop, their lookups independent of each other,
+     * the window of each stream is refilled with one unaligned 8-byte load per several characters and no bounds are checked,
+     * as long as every stream has 8 bytes of input, 64 bits of code and 64 bytes of buffer left,
+     * the rest is left to the careful path,
+     * lookups are made in Table::runs when the table has them, in the primary table of Table::entries otherwise
+     * @tparam N number of streams
+     * @param r Reader of each stream
+     */
+    template <std::size_t N>
+    inline void fast(std::array<Reader<const uint8_t *>, N> &r) const
+    {
+        if (table.runs.empty())
+            _fast<false>(r);
+        else
+            _fast<true>(r);
+        return;
+    }
+    /**
+     * @brief helper function for fast(r)
+     * @tparam Runs whether lookups are made in Table::runs
+     * @tparam N number of streams
+     * @param r Reader of each stream
+     */
+    template <bool Runs, std::size_t N>
+    void _fast(std::array<Reader<const uint8_t *>, N> &r) const
+    {
+        const Table::Entry *const entries = table.entries.data();
+        const Table::Run *const runs = table.runs.data();
+        const uint8_t width = table.width, lookups = 56 / width;
+        for (;;)
+        {
+            // rounds of a refill and lookups safe for all streams, a round taking no more than
+            // 7 bytes of input, 56 bits of code and 56 bytes of buffer, writing no more than 3 bytes beyond that
+            std::size_t rounds = SIZE_MAX;
+            for (const auto &i : r)
+            {
+                if (i.end - i.i < 8 || i.l2 - i.count < 64 || i.last - i.out < 64)
+                    return;
+                rounds = std::min({rounds, std::size_t(i.end - i.i - 8) / 7 + 1, (i.l2 - i.count - 64) / 56 + 1,
+                                   std::size_t(i.last - i.out - 64) / 56 + 1});
+            }
+            // state is copied into locals, so that it is kept in registers, stores to buffer may alias it otherwise
+            std::array<const uint8_t *, N> p;
+            std::array<uint64_t, N> bits;
+            std::array<uint8_t, N> left;
+            std::array<char *, N> o;
+            for (std::size_t k = 0; k < N; k++)
+            {
+                p[k] = r[k].i;
+                bits[k] = r[k].window;
+                left[k] = r[k].avail;
+                o[k] = r[k].out;
+            }
+            // a stream meeting a code longer than the primary table, N for none
+            std::size_t stuck = N;
+            for (; rounds && stuck == N; rounds--)
+            {
+                for (std::size_t k = 0; k < N; k++)
+                {
+                    // branchless refill, bits beyond left are the next bits of code as well
+                    bits[k] |= load(p[k]) >> left[k];
+                    p[k] += (63 - left[k]) >> 3;
+                    left[k] |= 56;
+                }
+                // no less than 56 bits in each window, enough for 56 / width lookups with no checks
+                for (uint8_t j = 0; j < lookups && stuck == N; j++)
+                    for (std::size_t k = 0; k < N; k++)
+                    {
+                        if constexpr (Runs)
+                        {
+                            const Table::Run u = runs[bits[k] >> (64 - width)];
+                            if (!u.count)
+                            {
+                                stuck = k;
+                                break;
+                            }
+                            // all 4 bytes are stored, only count of them kept
+                            std::memcpy(o[k], u.value.data(), u.value.size());
+                            o[k] += u.count;
+                            bits[k] <<= u.total;
+                            left[k] -= u.total;
+                        }
+                        else
+                        {
+                            const Table::Entry e = entries[bits[k] >> (64 - width)];
+                            if (!e.length)
+                            {
+                                stuck = k;
+                                break;
+                            }
+                            o[k][0] = char(e.value & 0xff);
+                            o[k][1] = char(e.value >> 8);
+                            o[k] += (e.total != e.length) ? 2 : 1;
+                            bits[k] <<= e.total;
+                            left[k] -= e.total;
+                        }
+                    }
+            }
+            for (std::size_t k = 0; k < N; k++)
+            {
+                // bits consumed are bits loaded less bits left in the window
+                r[k].count += 8 * std::size_t(p[k] - r[k].i) + r[k].avail - left[k];
+                r[k].i = p[k];
+                r[k].window = bits[k];
+                r[k].avail = left[k];
+                r[k].out = o[k];
+            }
+            if (stuck != N)
+                step(r[stuck]);
+        }
+    }
+    /**
+     * @brief decode with HFMTree::table, helper function for decode(begin, end, l2, buffer, capacity),
+     * bytes in memory take the fast path, then the careful path for the rest
+     * @tparam RandomAccessIterator
+     * @param begin iterator pointing to the beginning of the code
+     * @param end iterator pointing to the end of the code
+     * @param l2 length of the code in !!!bits!!!
+     * @param buffer destination
+     * @param capacity size of the buffer
+     * @param from bit offset decoding starts at, a checkpoint returned by checkpoints(string, every), defaults to 0
+     * @return std::size_t number of decoded characters
+     */
+    template <typename RandomAccessIterator>
+    std::size_t _decode(const RandomAccessIterator &begin, const RandomAccessIterator &end, const std::size_t &l2,
+                        char *buffer, const std::size_t &capacity, const std::size_t &from = 0) const
+    {
+        if (l2 && !table.width)
+            throw std::runtime_error("invalid code passed to HFMTree::decode.");
+        if (from > l2 || std::size_t(end - begin) < (from >> 3))
+            throw std::invalid_argument("invalid checkpoint passed to HFMTree::decode.");
+        HFM_STATS_SCOPE(decode, std::size_t(((l2 + 0b111) >> 3) - (from >> 3)));
+        std::array<Reader<RandomAccessIterator>, 1> r{Reader<RandomAccessIterator>(begin + (from >> 3), end, l2, buffer, capacity)};
+        // starting at a checkpoint, in the middle of a byte
+        r[0].count = from & ~std::size_t(0b111);
+        if (from & 0b111)
+        {
+            r[0].refill();
+            r[0].consume(uint8_t(from & 0b111));
+        }
+        if constexpr (std::is_same_v<RandomAccessIterator, const uint8_t *>)
+            fast(r);
+        while (!r[0].done() && step(r[0]))
+            ;
+        HFM_STATS_OUT(std::size_t(r[0].out - buffer));
+        return std::size_t(r[0].out - buffer);
+    }
+
+    /**
+     * @brief the code-length header of canonical codes, [1 byte flags][code lengths], see *.hfmtree with canonical codes
+     * @return std::vector<uint8_t>
+     */
+    std::vector<uint8_t> lengths_header() const
+    {
+        auto l = lengths();
+        const uint8_t flags = lengths_flags();
+        std::vector<uint8_t> header(lengths_size(flags));
+        header[0] = flags;
+        if (!(flags & 2))
+            l.resize(alphabet >> 1);
+        if (flags & 1)
+            std::copy(l.begin(), l.end(), header.begin() + 1);
+        else
+            for (std::size_t j = 0; j < (l.size() >> 1); j++)
+                header[j + 1] = uint8_t((l[j << 1] << 4) | l[(j << 1) | 1]);
+        return header;
+    }
+    /**
+     * @brief write the code-length header of canonical codes, see lengths_header()
+     * @param o std::ostream, required to be opened in binary mode
+     * @return std::size_t size of the header in bytes
+     */
+    std::size_t write_lengths(std::ostream &o) const
+    {
+        const auto header = lengths_header();
+        o.write((const char *)(header.data()), header.size());
+        return header.size();
+    }
+    /** @brief flags of the code-length header returned by lengths_header(), its first byte */
+    inline uint8_t lengths_flags() const { return (longest() > 0b1111 ? 1 : 0) | (sequenceable() ? 0 : 2); }
+    /**
+     * @brief size of a code-length header returned by lengths_header()
+     * @param flags first byte of the header
+     * @return std::size_t
+     */
+    static inline std::size_t lengths_size(const uint8_t &flags) noexcept { return 1 + (((flags & 2) ? alphabet : (alphabet >> 1)) >> ((flags & 1) ? 0 : 1)); }
+    /**
+     * @brief read the code-length header of canonical codes written by write_lengths(std::ostream &o)
+     * @param p pointer to the header, moved to the end of the header
+     * @param end end of readable bytes
+     * @return std::vector<uint8_t> code length of each character
+     */
+    static std::vector<uint8_t> read_lengths(const uint8_t *&p, const uint8_t *end)
+    {
+        if (p == end || std::size_t(end - p) < lengths_size(*p))
+            throw std::runtime_error("truncated code-length header passed to class HFMTree.");
+        if (*p & ~0b11)
+            throw std::runtime_error("invalid code-length header passed to class HFMTree.");
+        const uint8_t flags = *p++;
+        const std::size_t n = (flags & 2) ? alphabet : (alphabet >> 1);
+        std::vector<uint8_t> lengths(alphabet);
+        if (flags & 1)
+            std::copy(p, p + n, lengths.begin());
+        else
+            for (std::size_t j = 0; j < (n >> 1); j++)
+            {
+                lengths[j << 1] = p[j] >> 4;
+                lengths[(j << 1) | 1] = p[j] & 0b1111;
+            }
+        p += lengths_size(flags) - 1;
+        return lengths;
+    }
+    /**
+     * @brief read the code-length header of canonical codes written by write_lengths(std::ostream &o)
+     * @param i std::istream, required to be opened in binary mode
+     * @return std::vector<uint8_t> code length of each character
+     */
+    static std::vector<uint8_t> read_lengths(std::istream &i)
+    {
+        std::vector<uint8_t> header(lengths_size(0b11));
+        i.read((char *)(&(header[0])), 1);
+        i.read((char *)(&(header[1])), lengths_size(header[0]) - 1);
+        const uint8_t *p = header.data();
+        return read_lengths(p, p + (i ? lengths_size(header[0]) : 0));
+    }
+
+    /**
+     * @brief get a huffman tree object from std::fstream, will be used in class HFMString
+     * @param i std::fstream, required to be opened in binary mode
+     * @param h HFMTree object
+     * @return std::fstream&
+     */
+    void get_from_fstream(std::fstream &i)
+    {
+        std::size_t l1;
+        i.read((char *)(&l1), sizeof(std::size_t));
+        if (l1 == canonical_magic)
+        {
+            *this = HFMTree(read_lengths(i));
+            return;
+        }
+        if (!i || l1 > max_sequence)
+            throw std::runtime_error("invalid sequenced tree passed to class HFMTree.");
+        std::vector<uint8_t> s(l1);
+        i.read((char *)(s.data()), l1);
+        if (!i)
+            throw std::runtime_error("truncated sequenced tree passed to class HFMTree.");
+        *this = HFMTree(s.begin(), s.end());
+        return;
+    }
+
+public:
+    /** @brief magic number starting a *.hfmtree with canonical codes, "HFMCANON" in bytes */
+    constexpr static std::size_t canonical_magic = 0x4e4f4e41434d4648;
+    /** @brief number of interleaved streams, see encode_interleaved(const std::string_view &string) */
+    constexpr static std::size_t streams = 4;
+
+    /** @brief counting characters, Counter.size() should be HFMTree::alphabet*/
+    class Counter : private std::vector<std::size_t>
+    {
+    public:
+        /** @brief number of interleaved histograms used by Counter::count */
+        constexpr static std::size_t lanes = 4;
+        /** @brief size of a chunk of text counted by Counter::sample in bytes */
+        constexpr static std::size_t chunk = 4096;
+
+        Counter() : std::vector<std::size_t>(alphabet) {}
+        Counter(const Counter &) = default;
+        Counter(Counter &&) = default;
+        /**
+         * @brief Construct a new Counter object counting characters in text
+         * @param text text to be counted
+         * @param threads number of threads, text is split into as many shards, each counted on a thread of its own
+         */
+        explicit Counter(const std::string_view &text, const std::size_t &threads = 1) : std::vector<std::size_t>(alphabet)
+        {
+            const std::size_t n = std::max<std::size_t>(std::min(threads, text.size() >> 16), 1);
+            std::vector<Counter> shards(n);
+            HFMPool::run(n, n, [&](const std::size_t &k)
+                         { shards[k].count(text.substr(text.size() / n * k, (k + 1 == n) ? std::string_view::npos : text.size() / n)); });
+            for (const auto &shard : shards)
+                *this += shard;
+        }
+        Counter &operator=(const Counter &) = default;
+        Counter &operator=(Counter &&) = default;
+        virtual ~Counter() = default;
+
+        /**
+         * @brief count characters in text, adding to the counts so far
+         * consecutive bytes are counted into Counter::lanes histograms in turn, so that repeated characters
+         * do not wait for each other's increments, the histograms are merged at last
+         * @param text text to be counted, any bytes
+         * @return Counter&
+         */
+        Counter &count(const std::string_view &text)
+        {
+            HFM_STATS_SCOPE(count, text.size());
+            std::array<std::array<std::size_t, alphabet>, lanes> histogram{};
+            const uint8_t *p = (const uint8_t *)(text.data());
+            std::size_t i = 0;
+            for (; i + 2 * lanes <= text.size(); i += 2 * lanes)
+            {
+                uint64_t w;
+                std::memcpy(&w, p + i, sizeof(uint64_t));
+                for (std::size_t j = 0; j < 2 * lanes; j++)
+                    histogram[j % lanes][uint8_t(w >> (j << 3))]++;
+            }
+            for (; i < text.size(); i++)
+                histogram[i % lanes][p[i]]++;
+            for (std::size_t c = 0; c < alphabet; c++)
+                for (std::size_t j = 0; j < lanes; j++)
+                    (*this)[c] += histogram[j][c];
+            return *this;
+        }
+        /**
+         * @brief count characters in a sample of text approximately, adding to the counts so far
+         * text is split into groups of rate chunks, a chunk of each group is counted as rate of them,
+         * the rest of text shorter than a group is counted exactly,
+         * characters absent from the chunks counted are not counted, see HFMDictionary::train
+         * @param text text to be counted, any bytes
+         * @param rate number of chunks a chunk is counted for, 1 for counting all of text
+         * @param seed seed choosing the chunk of each group
+         * @return Counter&
+         */
+        Counter &sample(const std::string_view &text, const std::size_t &rate, const uint64_t &seed = 0)
+        {
+            if (!rate)
+                throw std::invalid_argument("zero sampling rate passed to HFMTree::Counter::sample.");
+            const std::size_t group = chunk * rate, full = text.size() / group * group;
+            Counter sampled;
+            uint64_t state = seed;
+            for (std::size_t g = 0; g < full; g += group)
+            {
+                // a step of the 64-bit LCG of Knuth's MMIX, its high bits taken
+                state = state * 6364136223846793005 + 1442695040888963407;
+                sampled.count(text.substr(g + std::size_t(state >> 33) % rate * chunk, chunk));
+            }
+            for (std::size_t c = 0; c < alphabet; c++)
+                (*this)[c] += sampled[c] * rate;
+            return count(text.substr(full));
+        }
+        /**
+         * @brief merge counts of characters, e.g. counted by another thread or node
+         * @param other Counter
+         * @return Counter&
+         */
+        Counter &operator+=(const Counter &other) noexcept
+        {
+            for (std::size_t c = 0; c < alphabet; c++)
+                (*this)[c] += other[c];
+            return *this;
+        }
+
+        /**
+         * @brief write the counts, see counter
+         * @param o std::ostream, required to be opened in binary mode
+         * @return std::size_t size in bytes
+         */
+        std::size_t write(std::ostream &o) const
+        {
+            std::size_t n = 0;
+            for (std::size_t c = 0; c < alphabet; c++)
+                n += (*this)[c] ? 1 : 0;
+            std::size_t bytes = write_varint(o, n);
+            for (std::size_t c = 0; c < alphabet; c++)
+                if ((*this)[c])
+                {
+                    const uint8_t b = uint8_t(c);
+                    o.write((const char *)(&b), 1);
+                    bytes += 1 + write_varint(o, (*this)[c]);
+                }
+            return bytes;
+        }
+        /**
+         * @brief read counts written by write(std::ostream &o)
+         * @param p pointer to the counts, moved to the end of them
+         * @param end end of readable bytes
+         * @return Counter
+         */
+        static Counter read(const uint8_t *&p, const uint8_t *end)
+        {
+            Counter counter;
+            const std::size_t n = read_varint(p, end);
+            if (n > alphabet)
+                throw std::runtime_error("corrupted counter passed to class HFMTree::Counter.");
+            for (std::size_t k = 0, last = 0; k < n; k++)
+            {
+                if (p == end)
+                    throw std::runtime_error("truncated counter passed to class HFMTree::Counter.");
+                const uint8_t c = *p++;
+                // characters ascending, counts not 0
+                if ((k && c <= last) || !(counter[c] = read_varint(p, end)))
+                    throw std::runtime_error("corrupted counter passed to class HFMTree::Counter.");
+                last = c;
+            }
+            return counter;
+        }
+
+        /** @brief total count of characters */
+        std::size_t total() const noexcept
+        {
+            std::size_t n = 0;
+            for (std::size_t c = 0; c < size(); c++)
+                n += (*this)[c];
+            return n;
+        }
+        /** @brief entropy of the counted characters, the lower bound of bits per character */
+        double entropy() const noexcept
+        {
+            const double n = double(total());
+            double h = 0;
+            for (std::size_t c = 0; c < size(); c++)
+                if ((*this)[c])
+                    h -= double((*this)[c]) / n * std::log2(double((*this)[c]) / n);
+            return h;
+        }
+
+        inline std::size_t &operator[](std::size_t index) noexcept { return std::vector<std::size_t>::operator[](index); }
+        inline const std::size_t &operator[](std::size_t index) const noexcept { return std::vector<std::size_t>::operator[](index); }
+        inline std::size_t size() const noexcept { return std::vector<std::size_t>::size(); }
+
+    private:
+        /**
+         * @brief write a LEB128 varint, helper function for write(std::ostream &o)
+         * @return std::size_t size in bytes
+         */
+        static std::size_t write_varint(std::ostream &o, std::size_t v)
+        {
+            std::array<uint8_t, 10> b;
+            std::size_t n = 0;
+            for (; v >> 7; v >>= 7)
+                b[n++] = uint8_t(v | 0b10000000);
+            b[n++] = uint8_t(v);
+            o.write((const char *)(b.data()), std::streamsize(n));
+            return n;
+        }
+        /** @brief read a LEB128 varint, helper function for read(p, end), p moved to the end of it */
+        static std::size_t read_varint(const uint8_t *&p, const uint8_t *end)
+        {
+            std::size_t v = 0;
+            for (uint8_t shift = 0;; shift += 7)
+            {
+                if (p == end)
+                    throw std::runtime_error("truncated counter passed to class HFMTree::Counter.");
+                const uint8_t b = *p++;
+                if (shift > 63 || (shift == 63 && (b & 0b01111110)))
+                    throw std::runtime_error("corrupted counter passed to class HFMTree::Counter.");
+                v |= std::size_t(b & 0b01111111) << shift;
+                if (!(b & 0b10000000))
+                    return v;
+            }
+        }
+    };
+
+    HFMTree() : tree(), code(), canonical(false), table() {}
+    HFMTree(const HFMTree &other) = default;
+    HFMTree(HFMTree &&other) = default;
+    /** @brief trees built for texts with non-ASCII bytes use canonical codes, see sequenceable() */
+    HFMTree(const std::string &s) : tree(build_tree(s)), code(generate_code(tree)), canonical(false), table(code)
+    {
+        if (!sequenceable())
+            canonicalize();
+    }
+    HFMTree(const char *s) : HFMTree(std::string(s)) {}
+    HFMTree(const Counter &c) : HFMTree(c, std::pmr::get_default_resource()) {}
+    /**
+     * @brief Construct a new HFMTree object, allocating its decode table from a memory resource,
+     * e.g. a std::pmr::unsynchronized_pool_resource per thread building many short-lived trees
+     * @param c counting characters, typed HFMTree::Counter
+     * @param resource memory resource, outliving the HFMTree object; copies allocate from the default resource
+     */
+    HFMTree(const Counter &c, std::pmr::memory_resource *resource)
+        : tree(build_tree(c)), code(generate_code(tree)), canonical(false), table(code, resource)
+    {
+        if (!sequenceable())
+            canonicalize();
+    }
+    template <typename RandomAccessIterator>
+    HFMTree(const RandomAccessIterator &begin, const RandomAccessIterator &end)
+        : tree(build_tree(begin, end)), code(generate_code(tree)), canonical(false), table(code) {}
+    /**
+     * @brief Construct a new HFMTree object with canonical codes, without building HFMTree::tree
+     * @param lengths code length of each character, 0 for absent characters
+     */
+    HFMTree(const std::vector<uint8_t> &lengths) : HFMTree(lengths, std::pmr::get_default_resource()) {}
+    /**
+     * @brief Construct a new HFMTree object with canonical codes, allocating its decode table from a memory resource
+     * @param lengths code length of each character, 0 for absent characters
+     * @param resource memory resource, outliving the HFMTree object; copies allocate from the default resource
+     */
+    HFMTree(const std::vector<uint8_t> &lengths, std::pmr::memory_resource *resource)
+        : tree(), code(generate_code(lengths)), canonical(true), table(code, resource) {}
+    /**
+     * @brief Construct a new HFMTree object with optimal canonical codes no longer than max_length
+     * @param c counting characters, typed HFMTree::Counter
+     * @param max_length maximum code length, at least log2 of the number of characters, no more than 57
+     */
+    HFMTree(const Counter &c, const uint8_t &max_length) : HFMTree(limit_lengths(c, max_length)) {}
+    virtual ~HFMTree() = default;
+    HFMTree &operator=(const HFMTree &other) = default;
+    HFMTree &operator=(HFMTree &&other) = default;
+
+    /**
+     * @brief get code lengths of each character
+     * @return std::vector<uint8_t> code length of each character, 0 for absent characters
+     */
+    std::vector<uint8_t> lengths() const
+    {
+        std::vector<uint8_t> l(code.size());
+        for (std::size_t i = 0; i < code.size(); i++)
+            l[i] = uint8_t(code[i].size());
+        return l;
+    }
+    /**
+     * @brief upper bound of the number of characters decoded from l2 bits of code
+     * @param l2 length of the code in !!!bits!!!
+     * @return std::size_t
+     */
+    inline std::size_t bound(const std::size_t &l2) const noexcept { return table.shortest ? l2 / table.shortest : 0; }
+    /** @brief length of the longest code */
+    uint8_t longest() const noexcept
+    {
+        uint8_t l = 0;
+        for (const auto &c : code)
+            l = std::max(l, c.length);
+        return l;
+    }
+    /**
+     * @brief average code length of characters counted, i.e. bits per character their text is coded in
+     * @param counter counting characters, typed HFMTree::Counter
+     * @return double, infinity if a counted character has no code
+     */
+    double average_length(const Counter &counter) const noexcept
+    {
+        const double n = double(counter.total());
+        double bits = 0;
+        for (std::size_t c = 0; c < alphabet; c++)
+            if (counter[c])
+                bits += code[c].length ? double(counter[c]) * code[c].length : HUGE_VAL;
+        return n ? bits / n : 0;
+    }
+    /**
+     * @brief bits per character wasted by coding the characters counted with this tree, compared to their entropy,
+     * growing as text drifts away from the text the tree was trained with
+     * @param counter counting characters, typed HFMTree::Counter
+     * @return double
+     */
+    inline double redundancy(const Counter &counter) const noexcept { return average_length(counter) - counter.entropy(); }
+    /** @brief whether the tree can be recorded in the sequenced form, i.e. all of its characters are ASCII */
+    bool sequenceable() const
+    {
+        for (std::size_t i = alphabet >> 1; i < alphabet; i++)
+            if (code[i].length)
+                return false;
+        return true;
+    }
+    /**
+     * @brief whether every character of a string has a code, as the noexcept encoders skip characters without one
+     * @param string string to be encoded
+     * @return bool
+     */
+    bool codes(const std::string_view &string) const noexcept
+    {
+        for (const auto &c : string)
+            if (!code[uint8_t(c)].length)
+                return false;
+        return true;
+    }
+    /**
+     * @brief identifier of the canonical codes of the HFMTree object, FNV-1a hash of its code lengths
+     * trees with the same id decode each other's text once canonicalized
+     * @return uint64_t
+     */
+    uint64_t id() const
+    {
+        uint64_t h = 0xcbf29ce484222325;
+        for (const auto &c : code)
+            h = (h ^ c.length) * 0x100000001b3;
+        return h;
+    }
+    /** @brief whether HFMTree::code are canonical codes */
+    inline bool is_canonical() const noexcept { return canonical; }
+    /**
+     * @brief replace HFMTree::code with canonical codes of the same lengths, HFMTree::tree is dropped
+     * text encoded before is no longer decodable after this
+     * @return HFMTree&
+     */
+    HFMTree &canonicalize()
+    {
+        if (canonical)
+            return *this;
+        code = generate_code(lengths());
+        table = Table(code, table.resource());
+        tree = Tree();
+        canonical = true;
+        return *this;
+    }
+
+    /**
+     * @brief length of the code of a string
+     * @param string string to be encoded
+     * @return std::size_t l2, in !!!bits!!!
+     */
+    std::size_t measure(const std::string_view &string) const noexcept
+    {
+        std::size_t l2 = 0;
+        for (const auto &i : string)
+            l2 += code[uint8_t(i)].length;
+        return l2;
+    }
+    /**
+     * @brief seek index of the code of a string, bit offset of every characters, see decode_range
+     * @param string string to be encoded
+     * @param every number of characters between checkpoints, not 0
+     * @return std::vector<std::size_t> bit offset in the code of characters every, 2 * every, ... of string
+     */
+    std::vector<std::size_t> checkpoints(const std::string_view &string, const std::size_t &every) const
+    {
+        if (!every)
+            throw std::invalid_argument("zero checkpoint interval passed to HFMTree::checkpoints.");
+        std::vector<std::size_t> marks;
+        marks.reserve(string.empty() ? 0 : (string.size() - 1) / every);
+        std::size_t l2 = 0;
+        for (std::size_t k = every; k < string.size(); k += every)
+        {
+            l2 += measure(string.substr(k - every, every));
+            marks.emplace_back(l2);
+        }
+        return marks;
+    }
+    /**
+     * @brief encode a string into a buffer, writing exactly (measure(string) + 7) / 8 bytes
+     * so that strings can be encoded side by side into one buffer, even in parallel
+     * @param string string to be encoded
+     * @param out destination
+     */
+    void encode(const std::string_view &string, uint8_t *out) const noexcept
+    {
+        HFM_STATS_SCOPE(encode, string.size());
+        [[maybe_unused]] uint8_t *const last = _encode(code, string, out);
+        HFM_STATS_OUT(std::size_t(last - out));
+        return;
+    }
+    /**
+     * @brief encode a string into a buffer and count its characters in the same pass, see encode(string, out),
+     * so that text is read once when its counts train the tree of the text after it
+     * @param string string to be encoded, containing characters with codes only
+     * @param out destination, no less than code_bound(string.size()) bytes
+     * @param counter counting characters of string, added to the counts so far
+     * @return std::size_t l2, in !!!bits!!!, (l2 + 7) / 8 bytes written
+     */
+    std::size_t encode(const std::string_view &string, uint8_t *out, Counter &counter) const noexcept
+    {
+        HFM_STATS_SCOPE(encode, string.size());
+        std::array<std::array<std::size_t, alphabet>, Counter::lanes> histogram{};
+        [[maybe_unused]] uint8_t *const last = _encode<true>(code, string, out, histogram.data());
+        HFM_STATS_OUT(std::size_t(last - out));
+        std::size_t l2 = 0;
+        for (std::size_t c = 0; c < alphabet; c++)
+        {
+            std::size_t n = 0;
+            for (const auto &h : histogram)
+                n += h[c];
+            counter[c] += n;
+            l2 += n * code[c].length;
+        }
+        return l2;
+    }
+    /**
+     * @brief upper bound of the size of the code of a string, e.g. for buffers of encode(string, out, counter)
+     * @param n size of the string
+     * @return std::size_t size in bytes
+     */
+    inline std::size_t code_bound(const std::size_t &n) const noexcept { return (n * longest() + 0b111) >> 3; }
+    /**
+     * @brief number of bytes holding l2 bits of code, never overflowing for l2 read from corrupted input
+     * @param l2 length of code in !!!bits!!!
+     * @return std::size_t
+     */
+    static constexpr std::size_t bytes(const std::size_t &l2) noexcept { return (l2 >> 3) + ((l2 & 0b111) ? 1 : 0); }
+    /**
+     * @brief encode a string with the HFMTree object
+     * @param string string to be encoded, typed const std::string_view&
+     * @return std::vector<uint8_t> encoded string, first [sizeof(std::size_t) bytes] for length of following code
+     */
+    std::vector<uint8_t> encode(const std::string_view &string) const
+    {
+        const std::size_t l2 = measure(string);
+        HFM_STATS_ALLOCATED(encode);
+        std::vector<uint8_t> result(sizeof(std::size_t) + ((l2 + 0b111) >> 3));
+        std::memcpy(&(result[0]), &l2, sizeof(std::size_t));
+        encode(string, result.data() + sizeof(std::size_t));
+        return result;
+    }
+    /**
+     * @brief encode a string into a buffer owned by the caller
+     * @param string string to be encoded
+     * @param out destination, [l2][code] as returned by encode(const std::string_view &string)
+     * @return std::size_t size of the encoded string in bytes
+     */
+    std::size_t encode_into(const std::string_view &string, const std::span<uint8_t> &out) const
+    {
+        const std::size_t l2 = measure(string), size = sizeof(std::size_t) + ((l2 + 0b111) >> 3);
+        if (out.size() < size)
+            throw std::invalid_argument("too small buffer passed to HFMTree::encode_into.");
+        std::memcpy(out.data(), &l2, sizeof(std::size_t));
+        encode(string, out.data() + sizeof(std::size_t));
+        return size;
+    }
+    /**
+     * @brief encode a string into a reusable buffer, which is reallocated only when it grows
+     * @param string string to be encoded
+     * @param out destination, [l2][code] as returned by encode(const std::string_view &string)
+     */
+    void encode_into(const std::string_view &string, std::vector<uint8_t> &out) const
+    {
+        const std::size_t l2 = measure(string);
+        out.resize(sizeof(std::size_t) + ((l2 + 0b111) >> 3));
+        std::memcpy(out.data(), &l2, sizeof(std::size_t));
+        encode(string, out.data() + sizeof(std::size_t));
+        return;
+    }
+    /**
+     * @brief decode a string encoded by encode(const std::string_view &string) into a buffer owned by the caller
+     * @param code [l2][code]
+     * @param out destination
+     * @return std::size_t size of decoded text, the rest of text is dropped if out is too small
+     */
+    std::size_t decode_into(const std::span<const uint8_t> &code, const std::span<char> &out) const
+    {
+        if (code.size() < sizeof(std::size_t))
+            throw std::invalid_argument("truncated code passed to HFMTree::decode_into.");
+        std::size_t l2;
+        std::memcpy(&l2, code.data(), sizeof(std::size_t));
+        return l2 ? decode(code.data() + sizeof(std::size_t), code.data() + code.size(), l2, out.data(), out.size()) : 0;
+    }
+    /**
+     * @brief decode a string encoded by encode(const std::string_view &string) into a reusable buffer,
+     * which is reallocated only when it grows
+     * @param code [l2][code]
+     * @param out destination
+     */
+    void decode_into(const std::span<const uint8_t> &code, std::string &out) const
+    {
+        if (code.size() < sizeof(std::size_t))
+            throw std::invalid_argument("truncated code passed to HFMTree::decode_into.");
+        std::size_t l2;
+        std::memcpy(&l2, code.data(), sizeof(std::size_t));
+        out.resize(bound(l2));
+        out.resize(decode_into(code, std::span<char>(out)));
+        return;
+    }
+    /**
+     * @brief encode a string into HFMTree::streams streams, the i-th of them coding the i-th quarter of the string,
+     * so that they are decoded side by side, see decode_interleaved(begin, end, buffer, size)
+     * @param string string to be encoded
+     * @return std::vector<uint8_t> [l2 of each stream][each stream, padded to bytes], the size of the string not included
+     */
+    std::vector<uint8_t> encode_interleaved(const std::string_view &string) const
+    {
+        const std::size_t quarter = (string.size() + streams - 1) / streams;
+        std::array<std::string_view, streams> part;
+        std::array<std::size_t, streams> l2;
+        std::size_t size = streams * sizeof(std::size_t);
+        for (std::size_t k = 0; k < streams; k++)
+        {
+            part[k] = string.substr(std::min(k * quarter, string.size()), quarter);
+            l2[k] = measure(part[k]);
+            size += (l2[k] + 0b111) >> 3;
+        }
+        std::vector<uint8_t> result(size);
+        std::memcpy(result.data(), l2.data(), streams * sizeof(std::size_t));
+        uint8_t *out = result.data() + streams * sizeof(std::size_t);
+        for (std::size_t k = 0; k < streams; k++)
+        {
+            encode(part[k], out);
+            out += (l2[k] + 0b111) >> 3;
+        }
+        return result;
+    }
+    /**
+     * @brief size of code written by encode_interleaved(const std::string_view &string)
+     * @param begin beginning of the code
+     * @param end end of readable bytes
+     * @return std::size_t size in bytes
+     */
+    static std::size_t interleaved_size(const uint8_t *begin, const uint8_t *end)
+    {
+        if (std::size_t(end - begin) < streams * sizeof(std::size_t))
+            throw std::runtime_error("truncated code passed to HFMTree::decode_interleaved.");
+        std::size_t size = streams * sizeof(std::size_t);
+        for (std::size_t k = 0; k < streams; k++)
+        {
+            std::size_t l2;
+            std::memcpy(&l2, begin + k * sizeof(std::size_t), sizeof(std::size_t));
+            if (std::size_t(end - begin) - size < bytes(l2))
+                throw std::runtime_error("truncated code passed to HFMTree::decode_interleaved.");
+            size += bytes(l2);
+        }
+        return size;
+    }
+    /**
+     * @brief decode code written by encode_interleaved(const std::string_view &string),
+     * lookups of all streams are made in one loop, independent of each other
+     * @param begin beginning of the code
+     * @param end end of the code
+     * @param buffer destination
+     * @param size size of the encoded string, no more than the size of the buffer
+     */
+    void decode_interleaved(const uint8_t *begin, const uint8_t *end, char *buffer, const std::size_t &size) const
+    {
+        const std::size_t quarter = (size + streams - 1) / streams;
+        const uint8_t *p = begin + streams * sizeof(std::size_t), *const last = begin + interleaved_size(begin, end);
+        HFM_STATS_SCOPE(decode, std::size_t(last - begin));
+        HFM_STATS_OUT(size);
+        std::array<Reader<const uint8_t *>, streams> r{
+            Reader<const uint8_t *>(p, p, 0, buffer, 0), Reader<const uint8_t *>(p, p, 0, buffer, 0),
+            Reader<const uint8_t *>(p, p, 0, buffer, 0), Reader<const uint8_t *>(p, p, 0, buffer, 0)};
+        for (std::size_t k = 0; k < streams; k++)
+        {
+            std::size_t l2;
+            std::memcpy(&l2, begin + k * sizeof(std::size_t), sizeof(std::size_t));
+            const std::size_t from = std::min(k * quarter, size);
+            r[k] = Reader<const uint8_t *>(p, std::min(p + bytes(l2), last), l2, buffer + from, std::min(quarter, size - from));
+            p = r[k].end;
+            if (l2 && !table.width)
+                throw std::runtime_error("invalid code passed to HFMTree::decode_interleaved.");
+        }
+        fast(r);
+        for (auto &i : r)
+        {
+            while (!i.done() && step(i))
+                ;
+            if (i.out != i.last)
+                throw std::runtime_error("corrupted code passed to HFMTree::decode_interleaved.");
+        }
+        return;
+    }
+    /**
+     * @brief decode code written by encode_interleaved(const std::string_view &string)
+     * @param code code
+     * @param size size of the encoded string
+     * @return std::string
+     */
+    inline std::string decode_interleaved(const std::vector<uint8_t> &code, const std::size_t &size) const
+    {
+        std::string result(size, '\0');
+        decode_interleaved(code.data(), code.data() + code.size(), result.data(), size);
+        return result;
+    }
+    /**
+     * @brief decode HFMString::code with the HFMTree object, resolving up to Table::bits bits per lookup in HFMTree::table
+     * @tparam RandomAccessIterator
+     * @param begin iterator pointing to the beginning of the code
+     * @param end iterator pointing to the end of the code
+     * @param l2 length of the code in !!!bits!!!
+     * @return std::string
+     */
+    template <typename RandomAccessIterator>
+    std::string decode(const RandomAccessIterator &begin, const RandomAccessIterator &end, const std::size_t &l2) const
+    {
+        if (!l2)
+            return std::string();
+        HFM_STATS_ALLOCATED(decode);
+        // no more characters than bits of code there are, for l2 read from corrupted input
+        std::string result(bound(std::min(l2, std::size_t(end - begin) * 8)), '\0');
+        result.resize(decode(begin, end, l2, result.data(), result.size()));
+        return result;
+    }
+    /**
+     * @brief decode HFMString::code with the HFMTree object into a buffer, stopping when the buffer is full
+     * @tparam RandomAccessIterator
+     * @param begin iterator pointing to the beginning of the code
+     * @param end iterator pointing to the end of the code
+     * @param l2 length of the code in !!!bits!!!
+     * @param buffer destination
+     * @param capacity size of the buffer
+     * @return std::size_t number of decoded characters
+     */
+    template <typename RandomAccessIterator>
+    std::size_t decode(const RandomAccessIterator &begin, const RandomAccessIterator &end, const std::size_t &l2,
+                       char *buffer, const std::size_t &capacity) const
+    {
+        if constexpr (std::contiguous_iterator<RandomAccessIterator> && sizeof(std::iter_value_t<RandomAccessIterator>) == 1)
+            return _decode((const uint8_t *)(std::to_address(begin)), (const uint8_t *)(std::to_address(begin)) + (end - begin), l2, buffer, capacity);
+        else
+            return _decode(begin, end, l2, buffer, capacity);
+    }
+    /**
+     * @brief decode characters [offset, offset + length) of a string only, starting at the nearest checkpoint before offset
+     * @param begin beginning of the code
+     * @param end end of the code
+     * @param l2 length of the code in !!!bits!!!
+     * @param marks checkpoints of the string, as returned by checkpoints(string, every), fewer are used as well
+     * @param every number of characters between checkpoints, not 0
+     * @param offset first character decoded
+     * @param buffer destination
+     * @param length number of characters decoded at most, no more than the size of the buffer
+     * @return std::size_t number of decoded characters, less than length at the end of the string
+     */
+    std::size_t decode_range(const uint8_t *begin, const uint8_t *end, const std::size_t &l2, const std::span<const std::size_t> &marks,
+                             const std::size_t &every, const std::size_t &offset, char *buffer, const std::size_t &length) const
+    {
+        if (!every)
+            throw std::invalid_argument("zero checkpoint interval passed to HFMTree::decode_range.");
+        if (!length)
+            return 0;
+        const std::size_t c = std::min(offset / every, marks.size()), skip = offset - c * every, from = c ? marks[c - 1] : 0;
+        if (!skip)
+            return _decode(begin, end, l2, buffer, length, from);
+        // no more characters are skipped and decoded than the code left after the checkpoint holds,
+        // for offsets far beyond the checkpoints given
+        const std::size_t most = bound(l2 - std::min(from, l2));
+        if (skip >= most)
+            return 0;
+        std::string text(skip + std::min(length, most - skip), '\0');
+        const std::size_t n = _decode(begin, end, l2, text.data(), text.size(), from);
+        if (n <= skip)
+            return 0;
+        std::memcpy(buffer, text.data() + skip, n - skip);
+        return n - skip;
+    }
+    /**
+     * @brief decode characters [offset, offset + length) of a string encoded by encode(const std::string_view &string) only
+     * @param code [l2][code] as returned by encode(const std::string_view &string)
+     * @param marks checkpoints of the string, as returned by checkpoints(string, every)
+     * @param every number of characters between checkpoints, not 0
+     * @param offset first character decoded
+     * @param length number of characters decoded at most
+     * @return std::string
+     */
+    std::string decode_range(const std::vector<uint8_t> &code, const std::span<const std::size_t> &marks, const std::size_t &every,
+                             const std::size_t &offset, const std::size_t &length) const
+    {
+        if (code.size() < sizeof(std::size_t))
+            throw std::runtime_error("invalid code passed to HFMTree::decode_range.");
+        std::size_t l2;
+        std::memcpy(&l2, code.data(), sizeof(std::size_t));
+        std::string result(std::min(length, bound(l2)), '\0');
+        result.resize(decode_range(code.data() + sizeof(std::size_t), code.data() + code.size(), l2, marks, every, offset, result.data(), result.size()));
+        return result;
+    }
+    /**
+     * @brief decode HFMString::code with the HFMTree object bit by bit, walking HFMTree::tree
+     * reference implementation of decode(begin, end, l2)
+     * @tparam RandomAccessIterator
+     * @param begin iterator pointing to the beginning of the code
+     * @param end iterator pointing to the end of the code
+     * @param l2 length of the code in !!!bits!!!
+     * @return std::string
+     */
+    template <typename RandomAccessIterator>
+    std::string decode_walk(const RandomAccessIterator &begin, const RandomAccessIterator &end, const std::size_t &l2) const
+    {
+        std::vector<char> v;
+        std::size_t count = 0;
+        uint8_t p = 0b10000000;
+        const Tree walk = tree.empty() ? build_tree(code) : tree;
+        uint16_t t = walk.root;
+        for (auto _i = begin; _i != end; _i++)
+        {
+            const auto &i = *_i;
+            for (p = 0b10000000; p; p >>= 1)
+            {
+                t = (p & i) ? walk[t].right : walk[t].left;
+                count++;
+                if (walk[t].is_leaf())
+                {
+                    v.push_back(walk[t].value);
+                    t = walk.root;
+                    if (count == l2)
+                        break;
+                }
+            }
+        }
+        return std::string(v.begin(), v.end());
+    }
+    /**
+     * @brief decode HFMString::code with the HFMTree object
+     * @param code HFMString::code to be decoded !!!WITHOUT!!! the part storing l2, typed std::vector<uint8_t>,
+     * @return std::string
+     */
+    inline std::string decode(const std::vector<uint8_t> &code, const std::size_t &l2) const { return decode(code.begin(), code.end(), l2); }
+    /**
+     * @brief decode HFMString::code with the HFMTree object
+     * @param code HFMString::code to be decoded, !!!WITH!!! the part storing l2 typed std::vector<uint8_t>
+     * @return std::string
+     */
+    inline std::string decode(const std::vector<uint8_t> &code) const
+    {
+        if (code.size() < sizeof(std::size_t))
+            throw std::runtime_error("invalid code passed to HFMTree::decode.");
+        std::size_t l2 = *((std::size_t *)(&code[0]));
+        return decode(code.begin() + sizeof(std::size_t), code.end(), l2);
+    }
+
+    /**
+     * @brief operator<< reloaded for std::ostream, e.g. std::fstream
+     * @param o std::ostream, required to be opened in binary mode
+     * @param h HFMTree object
+     * @return std::ostream&
+     */
+    friend std::ostream &operator<<(std::ostream &o, const HFMTree &h)
+    {
+        if (h.canonical)
+        {
+            o.write((const char *)(&canonical_magic), sizeof(std::size_t));
+            h.write_lengths(o);
+            return o;
+        }
+        auto s = h.sequence();
+        std::size_t l1 = s.size();
+        o.write((const char *)(&l1), sizeof(std::size_t));
+        o.write((const char *)(&(s[0])), s.size());
+        return o;
+    }
+
+    /** @brief print tree(sequenced)*/
+    void print_tree() const
+    {
+        auto s = sequence();
+        for (const auto &i : s)
+        {
+            if (i == 0b10000000)
+                std::cout << '(';
+            else if (i == 0b10000001)
+                std::cout << ')';
+            else
+                std::cout << uint16_t(i);
+        }
+        std::cout << std::endl;
+        return;
+    }
+};
+
+/**
+ * @brief
+ * compressor and decompressor of *.hfmtree in blocks, streaming block by block or working on blocks in parallel,
+ * a streaming compressor holds no more than a block of text in memory, coding every block with a HFMTree of its own,
+ * or with the tree of the previous block until the text drifts away from it, see HFMStream::Retrainer
+ */
+class HFMStream
+{
+public:
+    /** @brief magic number starting a *.hfmtree in blocks, "HFMBLOCK" in bytes */
+    constexpr static std::size_t magic = 0x4b434f4c424d4648;
+    /** @brief default size of a block of text in bytes */
+    constexpr static std::size_t default_block = std::size_t(1) << 20;
+
+    /** @brief index of a *.hfmtree in blocks, (offset of the block in the file, offset of its text) for each block */
+    using Index = std::vector<std::pair<std::size_t, std::size_t>>;
+
+    /**
+     * @brief build a HFMTree with canonical codes for a block of text
+     * a block composed of a single character is given a dummy second one, so that it still has a huffman tree
+     * @param text block of text, not empty
+     * @return HFMTree
+     */
+    static inline HFMTree train(const std::string_view &text) { return train(HFMTree::Counter(text)); }
+    /**
+     * @brief build a HFMTree with canonical codes for characters counted, see train(const std::string_view &text)
+     * @param c counting characters, typed HFMTree::Counter, not empty
+     * @return HFMTree
+     */
+    static HFMTree train(const HFMTree::Counter &c)
+    {
+        HFMTree::Counter counter(c);
+        std::size_t used = 0, last = 0;
+        for (std::size_t i = 0; i < counter.size(); i++)
+            if (counter[i])
+            {
+                used++;
+                last = i;
+            }
+        if (used == 1)
+            counter[(last + 1) % counter.size()]++;
+        HFMTree tree(counter);
+        tree.canonicalize();
+        return tree;
+    }
+    /**
+     * @brief build a HFMTree with canonical codes for all characters, from characters counted in a sample of text,
+     * every character is counted once more than in the sample, so that text with characters absent from the sample is still coded
+     * @param sample characters counted in the sample
+     * @return HFMTree
+     */
+    static HFMTree train_all(HFMTree::Counter sample)
+    {
+        for (std::size_t i = 0; i < HFMTree::alphabet; i++)
+            sample[i]++;
+        return HFMTree(sample).canonicalize();
+    }
+
+    /**
+     * @brief
+     * trainer of the tree of a long-running stream of texts (blocks, messages), retraining it only as the text drifts,
+     * so that tree building and headers are paid for when they are worth it:
+     * recent characters are counted into a rolling Counter, its counts halved as long as they would exceed a window otherwise,
+     * the tree is kept as long as the bits it wastes on recent characters, compared to those of a tree trained for them,
+     * are less than a threshold, otherwise it is retrained with the rolling Counter,
+     * bits of a tree trained for recent characters are estimated without building it, as their entropy plus the redundancy of
+     * the current tree when it was trained, plus the code-length header of the new tree
+     */
+    class Retrainer
+    {
+    private:
+        HFMTree current;
+        HFMTree::Counter rolling;
+        double threshold, baseline;
+        std::size_t window, retrained;
+
+    public:
+        /** @brief default number of recent characters counted */
+        constexpr static std::size_t default_window = std::size_t(1) << 16;
+
+        /**
+         * @brief Construct a new Retrainer object
+         * @param threshold least saving of a retrained tree on recent characters, relative to their bits with the current tree,
+         *                  0 for a tree trained for every text of its own, as train(const std::string_view &text)
+         * @param window number of recent characters counted, texts no shorter than that are judged and trained on their own
+         */
+        explicit Retrainer(const double &threshold, const std::size_t &window = default_window)
+            : threshold(threshold), baseline(0), window(window), retrained(0)
+        {
+            if (!(threshold >= 0))
+                throw std::invalid_argument("negative threshold passed to class HFMStream::Retrainer.");
+        }
+
+        /**
+         * @brief count the next text and decide its tree
+         * @param text next text, not empty
+         * @return bool whether the tree is retrained for the text, i.e. it is to be recorded along with the text
+         */
+        bool update(const std::string_view &text)
+        {
+            const HFMTree::Counter counter(text);
+            if (!threshold)
+            {
+                current = train(counter);
+                retrained++;
+                return true;
+            }
+            for (std::size_t total = rolling.total(); total && total + text.size() > window; total = rolling.total())
+                for (std::size_t c = 0; c < rolling.size(); c++)
+                    rolling[c] >>= 1;
+            rolling += counter;
+            if (retrained)
+            {
+                const double n = double(rolling.total());
+                // infinite for characters without codes
+                const double bits = current.average_length(rolling) * n;
+                const double fresh = (rolling.entropy() + baseline) * n + 8.0 * double(HFMTree::lengths_size(current.lengths_flags()));
+                if (std::isfinite(bits) && bits - fresh <= threshold * bits)
+                    return false;
+            }
+            current = train(rolling);
+            baseline = std::max(current.redundancy(rolling), 0.0);
+            retrained++;
+            return true;
+        }
+        /** @brief the tree of the last text, valid after update(text) */
+        inline const HFMTree &tree() const noexcept { return current; }
+        /** @brief number of times the tree has been trained */
+        inline std::size_t count() const noexcept { return retrained; }
+    };
+
+    /**
+     * @brief load a std::size_t from bytes
+     * @param p source, no alignment required
+     * @return std::size_t
+     */
+    static inline std::size_t load(const uint8_t *p) noexcept
+    {
+        std::size_t v;
+        std::memcpy(&v, p, sizeof(std::size_t));
+        return v;
+    }
+
+private:
+    /**
+     * @brief write a block, see *.hfmtree in blocks
+     * @param o std::ostream, required to be opened in binary mode
+     * @param l0 size of text in the block in bytes, not 0
+     * @param code coded text of the block, as returned by HFMTree::encode or HFMTree::encode_interleaved
+     * @param tree HFMTree of the block, nullptr for the block using the tree of the previous one
+     * @param interleaved whether code is returned by HFMTree::encode_interleaved
+     * @param marks checkpoints of the block as returned by HFMTree::checkpoints, empty for none
+     * @param every number of characters between checkpoints, 0 for blocks without a seek index
+     * @param checksum whether the block is followed by its CRC32C
+     * @return std::size_t size of the block in bytes
+     */
+    static std::size_t write_block(std::ostream &o, const std::size_t &l0, const std::span<const uint8_t> &code, const HFMTree *tree,
+                                   const bool &interleaved, const std::vector<std::size_t> &marks, const std::size_t &every,
+                                   const bool &checksum)
+    {
+        const uint8_t flags = (tree ? 1 : 0) | (interleaved ? 2 : 0) | (every ? 4 : 0) | (checksum ? 8 : 0);
+        uint32_t crc = 0;
+        std::size_t size = 0;
+        // fields are checksummed as they are written
+        const auto put = [&](const void *p, const std::size_t &n)
+        {
+            o.write((const char *)(p), n);
+            if (checksum)
+                crc = HFMCRC::update(crc, p, n);
+            size += n;
+        };
+        put(&l0, sizeof(std::size_t));
+        put(&flags, 1);
+        if (tree)
+        {
+            const auto header = tree->lengths_header();
+            put(header.data(), header.size());
+        }
+        if (every)
+        {
+            put(&every, sizeof(std::size_t));
+            put(marks.data(), marks.size() * sizeof(std::size_t));
+        }
+        put(code.data(), code.size());
+        if (checksum)
+        {
+            o.write((const char *)(&crc), sizeof(uint32_t));
+            size += sizeof(uint32_t);
+        }
+        return size;
+    }
+    /**
+     * @brief check flags of a block, helper function for reading a *.hfmtree in blocks
+     * @param flags flags of the block
+     */
+    static inline void check_flags(const uint8_t &flags)
+    {
+        if ((flags & ~0b1111) || (flags & 0b110) == 0b110)
+            throw std::runtime_error("invalid flags of block passed to HFMStream::decompress.");
+        return;
+    }
+    /**
+     * @brief append bytes read from a stream to a vector, helper function for HFMStream::decompress,
+     * the vector is grown a block at a time, so that a size read from a corrupted stream runs into the end of the stream
+     * before it is allocated
+     * @param i std::istream, required to be opened in binary mode
+     * @param v storing bytes read
+     * @param n number of bytes
+     */
+    static void read_bytes(std::istream &i, std::vector<uint8_t> &v, std::size_t n)
+    {
+        while (n && i)
+        {
+            const std::size_t m = std::min(n, default_block), size = v.size();
+            v.resize(size + m);
+            i.read((char *)(v.data() + size), std::streamsize(m));
+            n -= m;
+        }
+        if (!i)
+            throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+        return;
+    }
+    /**
+     * @brief checkpoints of a block of text, helper function for HFMStream::compress
+     * @param tree HFMTree of the block
+     * @param text text of the block
+     * @param every number of characters between checkpoints, 0 for none
+     * @return std::vector<std::size_t>
+     */
+    static inline std::vector<std::size_t> checkpoints(const HFMTree &tree, const std::string_view &text, const std::size_t &every)
+    {
+        return every ? tree.checkpoints(text, every) : std::vector<std::size_t>();
+    }
+    /**
+     * @brief size of the seek index of a block, helper function for reading a *.hfmtree in blocks
+     * @param p seek index of the block
+     * @param end end of readable bytes
+     * @param l0 size of text in the block
+     * @return std::size_t size in bytes
+     */
+    static std::size_t index_size(const uint8_t *p, const uint8_t *end, const std::size_t &l0)
+    {
+        if (std::size_t(end - p) < sizeof(std::size_t))
+            throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+        const std::size_t every = load(p);
+        if (!every)
+            throw std::runtime_error("zero checkpoint interval passed to HFMStream::decompress.");
+        if ((l0 - 1) / every >= std::size_t(end - p) / sizeof(std::size_t))
+            throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+        return ((l0 - 1) / every + 1) * sizeof(std::size_t);
+    }
+    /**
+     * @brief code a block of text, helper function for HFMStream::compress
+     * @param tree HFMTree of the block
+     * @param text text of the block
+     * @param interleaved whether text is coded in HFMTree::streams interleaved streams
+     * @return std::vector<uint8_t> coded text of the block
+     */
+    static inline std::vector<uint8_t> encode(const HFMTree &tree, const std::string_view &text, const bool &interleaved)
+    {
+        return interleaved ? tree.encode_interleaved(text) : tree.encode(text);
+    }
+    /**
+     * @brief size of coded text of a block, helper function for reading a *.hfmtree in blocks
+     * @param p coded text of the block
+     * @param end end of readable bytes
+     * @param flags flags of the block
+     * @return std::size_t size in bytes
+     */
+    static std::size_t code_size(const uint8_t *p, const uint8_t *end, const uint8_t &flags)
+    {
+        if (flags & 2)
+            return HFMTree::interleaved_size(p, end);
+        if (std::size_t(end - p) < sizeof(std::size_t))
+            throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+        const std::size_t size = sizeof(std::size_t) + HFMTree::bytes(load(p));
+        if (std::size_t(end - p) < size)
+            throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+        return size;
+    }
+    /**
+     * @brief decode coded text of a block, helper function for reading a *.hfmtree in blocks
+     * @param tree HFMTree of the block
+     * @param p coded text of the block
+     * @param size size of coded text in bytes, as returned by code_size(p, end, flags)
+     * @param flags flags of the block
+     * @param buffer destination
+     * @param l0 size of text in the block
+     */
+    static void decode(const HFMTree &tree, const uint8_t *p, const std::size_t &size, const uint8_t &flags, char *buffer, const std::size_t &l0)
+    {
+        if (flags & 2)
+            tree.decode_interleaved(p, p + size, buffer, l0);
+        else if (tree.decode(p + sizeof(std::size_t), p + size, load(p), buffer, l0) != l0)
+            throw std::runtime_error("corrupted block passed to HFMStream::decompress.");
+        return;
+    }
+    /**
+     * @brief decode characters [from, to) of a block only, helper function for reading a *.hfmtree in blocks,
+     * starting at the nearest checkpoint of its seek index, or at the beginning of the block without one
+     * @param tree HFMTree of the block
+     * @param p coded text of the block
+     * @param size size of coded text in bytes, as returned by code_size(p, end, flags)
+     * @param flags flags of the block
+     * @param marks seek index of the block, nullptr for none
+     * @param l0 size of text in the block
+     * @param from first character decoded
+     * @param to end of characters decoded, no more than l0
+     * @param buffer destination, no less than to - from bytes
+     */
+    static void decode_range(const HFMTree &tree, const uint8_t *p, const std::size_t &size, const uint8_t &flags, const uint8_t *marks,
+                             const std::size_t &l0, const std::size_t &from, const std::size_t &to, char *buffer)
+    {
+        if (flags & 2)
+        {
+            std::string text(l0, '\0');
+            decode(tree, p, size, flags, text.data(), l0);
+            std::memcpy(buffer, text.data() + from, to - from);
+            return;
+        }
+        std::vector<std::size_t> checkpoints;
+        std::size_t every = l0;
+        if (marks)
+        {
+            every = load(marks);
+            // checkpoints before to only
+            checkpoints.resize(std::min((l0 - 1) / every, to / every));
+            for (std::size_t k = 0; k < checkpoints.size(); k++)
+                checkpoints[k] = load(marks + (k + 1) * sizeof(std::size_t));
+        }
+        if (tree.decode_range(p + sizeof(std::size_t), p + size, load(p), checkpoints, every, from, buffer, to - from) != to - from)
+            throw std::runtime_error("corrupted block passed to HFMStream::decompress.");
+        return;
+    }
+    /**
+     * @brief read a block of a *.hfmtree in blocks, helper function for HFMStream::decompress
+     * @param i std::istream, required to be opened in binary mode
+     * @param l0 storing the size of text in the block, 0 for the end mark
+     * @param flags storing flags of the block
+     * @param lengths storing code lengths of the block with a code-length header
+     * @param code storing coded text of the block
+     * @return bool false for the end mark
+     */
+    static bool read_block(std::istream &i, std::size_t &l0, uint8_t &flags, std::vector<uint8_t> &lengths, std::vector<uint8_t> &code)
+    {
+        i.read((char *)(&l0), sizeof(std::size_t));
+        if (!i)
+            throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+        if (!l0)
+            return false;
+        // fields before the coded text, kept as read for the checksum
+        std::vector<uint8_t> fields((const uint8_t *)(&l0), (const uint8_t *)(&l0) + sizeof(std::size_t));
+        read_bytes(i, fields, 1);
+        flags = fields.back();
+        check_flags(flags);
+        if (flags & 1)
+        {
+            read_bytes(i, fields, 1);
+            read_bytes(i, fields, HFMTree::lengths_size(fields.back()) - 1);
+            const uint8_t *p = fields.data() + sizeof(std::size_t) + 1;
+            lengths = HFMTree::read_lengths(p, fields.data() + fields.size());
+        }
+        if (flags & 4)
+        {
+            read_bytes(i, fields, sizeof(std::size_t));
+            const std::size_t every = load(fields.data() + fields.size() - sizeof(std::size_t));
+            if (!every)
+                throw std::runtime_error("zero checkpoint interval passed to HFMStream::decompress.");
+            if ((l0 - 1) / every > SIZE_MAX / sizeof(std::size_t))
+                throw std::runtime_error("corrupted block passed to HFMStream::decompress.");
+            read_bytes(i, fields, (l0 - 1) / every * sizeof(std::size_t));
+        }
+        const std::size_t streams = (flags & 2) ? HFMTree::streams : 1;
+        code.clear();
+        read_bytes(i, code, streams * sizeof(std::size_t));
+        std::size_t bytes = 0;
+        for (std::size_t k = 0; k < streams; k++)
+            bytes += HFMTree::bytes(load(code.data() + k * sizeof(std::size_t)));
+        // every character is coded in 1 bit at least
+        if (HFMTree::bytes(l0) > bytes)
+            throw std::runtime_error("corrupted block passed to HFMStream::decompress.");
+        read_bytes(i, code, bytes);
+        if (flags & 8)
+        {
+            uint32_t crc = 0;
+            i.read((char *)(&crc), sizeof(uint32_t));
+            if (!i)
+                throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+            if (HFMCRC::update(HFMCRC::compute(fields.data(), fields.size()), code.data(), code.size()) != crc)
+                throw std::runtime_error("checksum mismatch in block passed to HFMStream::decompress.");
+        }
+        return true;
+    }
+    /**
+     * @brief write the end mark and the index of a *.hfmtree in blocks
+     * @param o std::ostream, required to be opened in binary mode
+     * @param index index of all blocks written
+     * @param offset offset of the end mark in the file
+     * @param size size of the whole text
+     */
+    static void write_end(std::ostream &o, Index index, const std::size_t &offset, const std::size_t &size)
+    {
+        const std::size_t end = 0, n = index.size();
+        o.write((const char *)(&end), sizeof(std::size_t));
+        index.emplace_back(offset, size);
+        for (const auto &i : index)
+        {
+            o.write((const char *)(&(i.first)), sizeof(std::size_t));
+            o.write((const char *)(&(i.second)), sizeof(std::size_t));
+        }
+        o.write((const char *)(&n), sizeof(std::size_t));
+        return;
+    }
+    /**
+     * @brief read the index of a *.hfmtree in blocks
+     * @param begin beginning of the file
+     * @param end end of the file
+     * @param index storing result, the entry of the end mark included
+     * @return bool false for files without a valid index
+     */
+    static bool read_index(const uint8_t *begin, const uint8_t *end, Index &index)
+    {
+        const std::size_t size = std::size_t(end - begin);
+        if (size < 3 * sizeof(std::size_t))
+            return false;
+        const std::size_t n = load(end - sizeof(std::size_t));
+        // the magic number, the end mark, n + 1 entries and n itself, (n + 1) * 2 * sizeof(std::size_t) never overflowing
+        if (!n || n >= (size - 3 * sizeof(std::size_t)) / (2 * sizeof(std::size_t)))
+            return false;
+        const uint8_t *const start = end - sizeof(std::size_t) - (n + 1) * 2 * sizeof(std::size_t), *p = start;
+        index.clear();
+        for (std::size_t k = 0; k <= n; k++, p += 2 * sizeof(std::size_t))
+        {
+            index.emplace_back(load(p), load(p + sizeof(std::size_t)));
+            if (k ? (index[k].first <= index[k - 1].first || index[k].second < index[k - 1].second)
+                  : (index[k].first != sizeof(std::size_t) || index[k].second))
+                return false;
+        }
+        // the end mark, right before the index
+        return index.back().first == std::size_t(start - begin) - sizeof(std::size_t) && !load(start - sizeof(std::size_t));
+    }
+    /**
+     * @brief scan blocks of a *.hfmtree in blocks one by one
+     * @param begin beginning of the file
+     * @param end end of the file
+     * @param index storing result, the entry of the end mark included
+     */
+    static void scan(const uint8_t *begin, const uint8_t *end, Index &index)
+    {
+        const uint8_t *p = begin + sizeof(std::size_t);
+        std::size_t text = 0;
+        index.clear();
+        for (;;)
+        {
+            if (std::size_t(end - p) < sizeof(std::size_t))
+                throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+            index.emplace_back(std::size_t(p - begin), text);
+            const std::size_t l0 = load(p);
+            if (!l0)
+                break;
+            if (std::size_t(end - p) < 2 * sizeof(std::size_t) + 2)
+                throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+            const uint8_t flags = p[sizeof(std::size_t)];
+            check_flags(flags);
+            const uint8_t *q = p + sizeof(std::size_t) + 1;
+            if (flags & 1)
+                q += HFMTree::lengths_size(*q);
+            if (q > end)
+                throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+            if (flags & 4)
+                q += index_size(q, end, l0);
+            p = q + code_size(q, end, flags);
+            if ((flags & 8) && std::size_t(end - p) < sizeof(uint32_t))
+                throw std::runtime_error("truncated stream passed to HFMStream::decompress.");
+            p += (flags & 8) ? sizeof(uint32_t) : 0;
+            text += l0;
+        }
+        return;
+    }
+
+public:
+    /**
+     * @brief compress text into a *.hfmtree in blocks
+     * @param i source text
+     * @param o std::ostream, required to be opened in binary mode
+     * @param block size of a block of text in bytes, defaults to HFMStream::default_block
+     * @param interleaved whether blocks are coded in HFMTree::streams interleaved streams, defaults to false
+     * @param every number of characters between checkpoints of the seek index of each block, 0 for none (defaults),
+     *              not along with interleaved
+     * @param drift least saving of a retrained tree, relative to the code of a block with the tree of the previous one,
+     *              for the block to be given a tree of its own, see HFMStream::Retrainer, 0 for a tree in every block (defaults)
+     * @param checksum whether every block is followed by its CRC32C, checked when it is decoded, defaults to false
+     */
+    static void compress(std::istream &i, std::ostream &o, const std::size_t &block = default_block, const bool &interleaved = false,
+                         const std::size_t &every = 0, const double &drift = 0, const bool &checksum = false)
+    {
+        if (!block)
+            throw std::invalid_argument("zero-sized block passed to class HFMStream.");
+        if (interleaved && every)
+            throw std::invalid_argument("seek index of interleaved blocks passed to class HFMStream.");
+        // a block is judged on its own text, as a block with a tree of its own would be
+        Retrainer retrainer(drift, block);
+        o.write((const char *)(&magic), sizeof(std::size_t));
+        Index index;
+        std::size_t offset = sizeof(std::size_t), size = 0;
+        // blocks are read, coded and written on 3 threads, so that I/O overlaps coding
+        HFMQueue<std::string> texts, blocks;
+        HFMQueue<std::string>::Stage reader(texts, [&]()
+                                            {
+                                                for (;;)
+                                                {
+                                                    std::string text(block, '\0');
+                                                    i.read(&(text[0]), block);
+                                                    text.resize(std::size_t(i.gcount()));
+                                                    if (text.empty() || !texts.push(std::move(text)))
+                                                        break;
+                                                } });
+        HFMQueue<std::string>::Stage writer(blocks, [&]()
+                                            {
+                                                while (auto b = blocks.pop())
+                                                    o.write(b->data(), b->size()); });
+        while (auto text = texts.pop())
+        {
+            const bool fresh = retrainer.update(*text);
+            const HFMTree &tree = retrainer.tree();
+            std::ostringstream b(std::ios::out | std::ios::binary);
+            index.emplace_back(offset, size);
+            offset += write_block(b, text->size(), encode(tree, *text, interleaved), fresh ? &tree : nullptr, interleaved,
+                                  checkpoints(tree, *text, every), every, checksum);
+            size += text->size();
+            if (!blocks.push(std::move(b).str()))
+                break;
+        }
+        reader.join();
+        writer.join();
+        write_end(o, index, offset, size);
+        return;
+    }
+    /**
+     * @brief compress text into a *.hfmtree in blocks, reading text once, with characters counted in advance,
+     * e.g. in earlier text or for a dictionary: the first block is coded with a tree trained from them,
+     * every other block with a tree trained from the counts of the block before it, counted in the pass coding that block,
+     * trees are trained by train_all, so that characters absent from the counts are still coded,
+     * a block with the same codes as the block before it is written without a code-length header
+     * @param i source text
+     * @param o std::ostream, required to be opened in binary mode
+     * @param stats characters counted in advance
+     * @param block size of a block of text in bytes, defaults to HFMStream::default_block
+     * @param checksum whether every block is followed by its CRC32C, checked when it is decoded, defaults to false
+     */
+    static void compress(std::istream &i, std::ostream &o, const HFMTree::Counter &stats, const std::size_t &block = default_block,
+                         const bool &checksum = false)
+    {
+        if (!block)
+            throw std::invalid_argument("zero-sized block passed to class HFMStream.");
+        o.write((const char *)(&magic), sizeof(std::size_t));
+        Index index;
+        std::size_t offset = sizeof(std::size_t), size = 0;
+        // blocks are read, coded and written on 3 threads, so that I/O overlaps coding
+        HFMQueue<std::string> texts, blocks;
+        HFMQueue<std::string>::Stage reader(texts, [&]()
+                                            {
+                                                for (;;)
+                                                {
+                                                    std::string text(block, '\0');
+                                                    i.read(&(text[0]), block);
+                                                    text.resize(std::size_t(i.gcount()));
+                                                    if (text.empty() || !texts.push(std::move(text)))
+                                                        break;
+                                                } });
+        HFMQueue<std::string>::Stage writer(blocks, [&]()
+                                            {
+                                                while (auto b = blocks.pop())
+                                                    o.write(b->data(), b->size()); });
+        HFMTree tree = train_all(stats);
+        // [l2][code] of a block, grown to the largest bound needed and reused
+        std::vector<uint8_t> code;
+        // code lengths of the tree of the previous block, its header skipped when they are the same, compared by id first
+        uint64_t last = 0;
+        std::vector<uint8_t> lengths;
+        while (auto text = texts.pop())
+        {
+            const uint64_t id = tree.id();
+            const bool same = index.size() && id == last && tree.lengths() == lengths;
+            code.resize(std::max(code.size(), sizeof(std::size_t) + tree.code_bound(text->size())));
+            HFMTree::Counter counter;
+            const std::size_t l2 = tree.encode(*text, code.data() + sizeof(std::size_t), counter);
+            std::memcpy(code.data(), &l2, sizeof(std::size_t));
+            std::ostringstream b(std::ios::out | std::ios::binary);
+            index.emplace_back(offset, size);
+            offset += write_block(b, text->size(), std::span<const uint8_t>(code.data(), sizeof(std::size_t) + ((l2 + 0b111) >> 3)),
+                                  same ? nullptr : &tree, false, {}, 0, checksum);
+            size += text->size();
+            if (!same)
+            {
+                last = id;
+                lengths = tree.lengths();
+            }
+            if (!blocks.push(std::move(b).str()))
+                break;
+            tree = train_all(counter);
+        }
+        reader.join();
+        writer.join();
+        write_end(o, index, offset, size);
+        return;
+    }
+    /**
+     * @brief compress text into a *.hfmtree in blocks, all blocks sharing one HFMTree and coded in parallel
+     * @param o std::ostream, required to be opened in binary mode
+     * @param tree HFMTree with canonical codes for all characters in text
+     * @param text source text
+     * @param block size of a block of text in bytes
+     * @param threads number of threads
+     * @param interleaved whether blocks are coded in HFMTree::streams interleaved streams, defaults to false
+     * @param every number of characters between checkpoints of the seek index of each block, 0 for none (defaults),
+     *              not along with interleaved
+     * @param checksum whether every block is followed by its CRC32C, checked when it is decoded, defaults to false
+     */
+    static void compress(std::ostream &o, const HFMTree &tree, const std::string_view &text, const std::size_t &block,
+                         const std::size_t &threads, const bool &interleaved = false, const std::size_t &every = 0, const bool &checksum = false)
+    {
+        if (!block)
+            throw std::invalid_argument("zero-sized block passed to class HFMStream.");
+        if (interleaved && every)
+            throw std::invalid_argument("seek index of interleaved blocks passed to class HFMStream.");
+        if (!tree.is_canonical())
+            throw std::invalid_argument("HFMTree without canonical codes passed to HFMStream::compress.");
+        if (!tree.codes(text))
+            throw std::invalid_argument("character without code passed to HFMStream::compress.");
+        const std::size_t n = (text.size() + block - 1) / block, wave = std::max<std::size_t>(threads, 1);
+
+        o.write((const char *)(&magic), sizeof(std::size_t));
+        Index index;
+        std::size_t offset = sizeof(std::size_t);
+        // blocks are coded in waves of one block per thread, a wave is written while the next one is coded
+        HFMQueue<std::string> blocks(2 * wave);
+        HFMQueue<std::string>::Stage writer(blocks, [&]()
+                                            {
+                                                while (auto b = blocks.pop())
+                                                    o.write(b->data(), b->size()); });
+        std::vector<std::string> written(wave);
+        for (std::size_t w = 0; w < n; w += wave)
+        {
+            const std::size_t m = std::min(wave, n - w);
+            HFMPool::run(m, threads, [&](const std::size_t &k)
+                         {
+                             const std::size_t j = w + k;
+                             const std::string_view part = text.substr(j * block, block);
+                             std::ostringstream b(std::ios::out | std::ios::binary);
+                             write_block(b, part.size(), encode(tree, part, interleaved), j ? nullptr : &tree, interleaved,
+                                         checkpoints(tree, part, every), every, checksum);
+                             written[k] = std::move(b).str(); });
+            for (std::size_t k = 0; k < m; k++)
+            {
+                index.emplace_back(offset, (w + k) * block);
+                offset += written[k].size();
+                if (!blocks.push(std::move(written[k])))
+                    break;
+            }
+        }
+        writer.join();
+        write_end(o, index, offset, text.size());
+        return;
+    }
+    /**
+     * @brief decompress a *.hfmtree in blocks, each block is written to o as soon as it is decoded
+     * @param i std::istream, required to be opened in binary mode
+     * @param o decoded text
+     * @param started whether the magic number has been read from i and checked already, defaults to false
+     */
+    static void decompress(std::istream &i, std::ostream &o, const bool &started = false)
+    {
+        std::size_t m = magic;
+        if (!started)
+            i.read((char *)(&m), sizeof(std::size_t));
+        if (m != magic)
+            throw std::invalid_argument("invalid stream passed to HFMStream::decompress.");
+        /** @brief a block read, its code-length header (if any) and coded text */
+        struct Block
+        {
+            std::size_t l0;
+            uint8_t flags;
+            std::vector<uint8_t> lengths, code;
+        };
+        // blocks are read, decoded and written on 3 threads, so that I/O overlaps decoding
+        HFMQueue<Block> blocks;
+        HFMQueue<std::string> texts;
+        HFMQueue<Block>::Stage reader(blocks, [&]()
+                                      {
+                                          for (;;)
+                                          {
+                                              Block b{0, 0, {}, {}};
+                                              if (!read_block(i, b.l0, b.flags, b.lengths, b.code) || !blocks.push(std::move(b)))
+                                                  break;
+                                          } });
+        HFMQueue<std::string>::Stage writer(texts, [&]()
+                                            {
+                                                while (auto text = texts.pop())
+                                                    o.write(text->data(), text->size()); });
+        HFMTree tree;
+        bool trained = false;
+        while (auto b = blocks.pop())
+        {
+            if (b->flags & 1)
+            {
+                tree = HFMTree(b->lengths);
+                trained = true;
+            }
+            else if (!trained)
+                throw std::runtime_error("block without huffman tree passed to HFMStream::decompress.");
+            std::string text(b->l0, '\0');
+            decode(tree, b->code.data(), b->code.size(), b->flags, text.data(), b->l0);
+            if (!texts.push(std::move(text)))
+                break;
+        }
+        reader.join();
+        writer.join();
+        return;
+    }
+    /**
+     * @brief a whole *.hfmtree in blocks in memory, blocks are located with the index (or by a scan for files without one),
+     * then their headers are read in parallel, ready to be decoded in parallel
+     */
+    class Blocks
+    {
+    private:
+        const uint8_t *begin;
+        Index index;
+        std::vector<HFMTree> own;
+        std::vector<uint8_t> flags;
+        std::vector<std::size_t> bytes, owner;
+        std::vector<const uint8_t *> code, marks;
+        /** @brief whether the checksum of each block has been checked */
+        std::unique_ptr<std::atomic<bool>[]> checked;
+
+        /**
+         * @brief check the checksum of a block, once for each block, before it is decoded
+         * @param k index of the block
+         * @return bool false for a block without a checksum
+         */
+        bool check(const std::size_t &k) const
+        {
+            if (!(flags[k] & 8))
+                return false;
+            if (checked[k].load(std::memory_order_acquire))
+                return true;
+            const uint8_t *const p = begin + index[k].first, *const q = code[k] + bytes[k];
+            uint32_t crc;
+            std::memcpy(&crc, q, sizeof(uint32_t));
+            if (HFMCRC::compute(p, std::size_t(q - p)) != crc)
+                throw std::runtime_error("checksum mismatch in block passed to HFMStream::decompress.");
+            checked[k].store(true, std::memory_order_release);
+            return true;
+        }
+
+    public:
+        /**
+         * @brief Construct a new Blocks object
+         * @param begin beginning of the file, required to outlive the Blocks object
+         * @param end end of the file
+         * @param threads number of threads
+         */
+        Blocks(const uint8_t *begin, const uint8_t *end, const std::size_t &threads) : begin(begin)
+        {
+            if (std::size_t(end - begin) < sizeof(std::size_t) || load(begin) != magic)
+                throw std::invalid_argument("invalid stream passed to HFMStream::decompress.");
+            if (!read_index(begin, end, index))
+                scan(begin, end, index);
+            const std::size_t n = index.size() - 1;
+            own.resize(n);
+            flags.resize(n);
+            bytes.resize(n);
+            code.resize(n);
+            marks.resize(n);
+            checked = std::make_unique<std::atomic<bool>[]>(n);
+            HFMPool::run(n, threads, [&](const std::size_t &k)
+                         {
+                             // a block never reaches into the next one, or into the end mark
+                             const uint8_t *p = begin + index[k].first, *const limit = begin + index[k + 1].first;
+                             if (std::size_t(limit - p) < sizeof(std::size_t) + 1 ||
+                                 load(p) != index[k + 1].second - index[k].second)
+                                 throw std::runtime_error("corrupted index passed to HFMStream::decompress.");
+                             flags[k] = p[sizeof(std::size_t)];
+                             check_flags(flags[k]);
+                             p += sizeof(std::size_t) + 1;
+                             if (flags[k] & 1)
+                                 own[k] = HFMTree(HFMTree::read_lengths(p, limit));
+                             if (flags[k] & 4)
+                             {
+                                 marks[k] = p;
+                                 p += index_size(p, limit, index[k + 1].second - index[k].second);
+                             }
+                             code[k] = p;
+                             bytes[k] = code_size(p, limit, flags[k]);
+                             // every character is coded in 1 bit at least
+                             if (HFMTree::bytes(index[k + 1].second - index[k].second) > bytes[k])
+                                 throw std::runtime_error("corrupted block passed to HFMStream::decompress.");
+                             if (std::size_t(limit - p) - bytes[k] != ((flags[k] & 8) ? sizeof(uint32_t) : 0))
+                                 throw std::runtime_error("corrupted block passed to HFMStream::decompress."); });
+            owner.resize(n);
+            for (std::size_t k = 0; k < n; k++)
+            {
+                if (!(flags[k] & 1) && !k)
+                    throw std::runtime_error("block without huffman tree passed to HFMStream::decompress.");
+                owner[k] = (flags[k] & 1) ? k : owner[k - 1];
+            }
+        }
+
+        /** @brief size of the whole text */
+        inline std::size_t size() const noexcept { return index.back().second; }
+        /** @brief HFMTree objects of the file in order */
+        std::vector<HFMTree> trees() const
+        {
+            std::vector<HFMTree> t;
+            for (std::size_t k = 0; k < own.size(); k++)
+                if (flags[k] & 1)
+                    t.emplace_back(own[k]);
+            return t;
+        }
+        /**
+         * @brief check the checksums of all blocks in parallel, without decoding them
+         * @param threads number of threads
+         * @return std::size_t number of blocks with a checksum, all of them intact
+         */
+        std::size_t verify(const std::size_t &threads) const
+        {
+            HFMPool::run(own.size(), threads, [&](const std::size_t &k)
+                         { check(k); });
+            return std::size_t(std::count_if(flags.begin(), flags.end(), [](const uint8_t &f)
+                                             { return f & 8; }));
+        }
+        /**
+         * @brief decode all blocks in parallel, each straight into its place in buffer, a block with a checksum is checked first
+         * @param buffer destination, no less than size() bytes
+         * @param threads number of threads
+         */
+        void decode(char *buffer, const std::size_t &threads) const
+        {
+            HFMPool::run(own.size(), threads, [&](const std::size_t &k)
+                         {
+                             check(k);
+                             HFMStream::decode(own[owner[k]], code[k], bytes[k], flags[k], buffer + index[k].second,
+                                               index[k + 1].second - index[k].second); });
+            return;
+        }
+        /**
+         * @brief decode characters [offset, offset + length) of the whole text only, from the blocks they are in,
+         * a block with a checksum is checked as a whole the first time it is decoded from
+         * @param offset first character decoded
+         * @param length number of characters decoded at most
+         * @param buffer destination, no less than length bytes
+         * @return std::size_t number of decoded characters, less than length at the end of the text
+         */
+        std::size_t decode_range(const std::size_t &offset, const std::size_t &length, char *buffer) const
+        {
+            if (offset >= size())
+                return 0;
+            const std::size_t last = offset + std::min(length, size() - offset);
+            // the block containing offset, the greatest k with index[k].second <= offset
+            std::size_t k = std::size_t(std::upper_bound(index.begin(), index.end(), offset,
+                                                         [](const std::size_t &o, const std::pair<std::size_t, std::size_t> &i)
+                                                         { return o < i.second; }) -
+                                        index.begin()) -
+                            1;
+            for (; k < own.size() && index[k].second < last; k++)
+            {
+                const std::size_t from = std::max(offset, index[k].second), to = std::min(last, index[k + 1].second);
+                check(k);
+                HFMStream::decode_range(own[owner[k]], code[k], bytes[k], flags[k], marks[k], index[k + 1].second - index[k].second,
+                                        from - index[k].second, to - index[k].second, buffer + (from - offset));
+            }
+            return last - offset;
+        }
+    };
+    /**
+     * @brief compress a text file into a *.hfmtree in blocks
+     * @param source path of source text
+     * @param target path of targeting file
+     * @param block size of a block of text in bytes, defaults to HFMStream::default_block
+     * @param interleaved whether blocks are coded in HFMTree::streams interleaved streams, defaults to false
+     * @param every number of characters between checkpoints of the seek index of each block, 0 for none (defaults)
+     * @param drift least relative saving of a retrained tree for a block to be given a tree of its own, 0 for a tree in every block (defaults)
+     * @param checksum whether every block is followed by its CRC32C, defaults to false
+     */
+    static void compress(const std::filesystem::path &source, const std::filesystem::path &target, const std::size_t &block = default_block,
+                         const bool &interleaved = false, const std::size_t &every = 0, const double &drift = 0, const bool &checksum = false)
+    {
+        std::fstream i(source, std::ios::in), o(target, std::ios::out | std::ios::binary);
+        compress(i, o, block, interleaved, every, drift, checksum);
+        return;
+    }
+    /**
+     * @brief decompress a *.hfmtree in blocks into a text file
+     * @param source path of the *.hfmtree
+     * @param target path of targeting text
+     */
+    static void decompress(const std::filesystem::path &source, const std::filesystem::path &target)
+    {
+        std::fstream i(source, std::ios::in | std::ios::binary), o(target, std::ios::out);
+        decompress(i, o);
+        return;
+    }
+};
+
+/**
+ * @brief
+ * read-only *.hfmtree of any kind mapped into memory (or already in memory), decoding straight from the mapped pages into buffers of the caller
+ */
+class HFMView
+{
+private:
+    const uint8_t *data;
+    std::size_t length;
+    /** @brief whether data is mapped by the HFMView object, otherwise it is owned by the caller */
+    bool mapped;
+#if defined(_WIN32)
+    HANDLE file, mapping;
+#endif
+    std::size_t threads;
+    /** @brief HFMTree, code and l2 of a single *.hfmtree */
+    HFMTree hfmtree;
+    const uint8_t *code;
+    std::size_t l2;
+    /** @brief blocks of a *.hfmtree in blocks, nullptr for a single *.hfmtree */
+    std::unique_ptr<HFMStream::Blocks> blocks;
+
+    /** @brief unmap the file */
+    void unmap() noexcept
+    {
+        if (!mapped)
+        {
+            data = nullptr;
+            length = 0;
+            return;
+        }
+#if defined(_WIN32)
+        if (data)
+            UnmapViewOfFile(data);
+        if (mapping)
+            CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        file = INVALID_HANDLE_VALUE;
+        mapping = nullptr;
+#else
+        if (data)
+            munmap((void *)(data), length);
+#endif
+        data = nullptr;
+        length = 0;
+        return;
+    }
+    /**
+     * @brief map a file into memory
+     * @param path path of the file
+     */
+    void map(const std::filesystem::path &path)
+    {
+#if defined(_WIN32)
+        file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER size;
+        if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size))
+            throw std::runtime_error("failed to open file in class HFMView.");
+        length = std::size_t(size.QuadPart);
+        if (!length)
+            return;
+        mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping)
+            data = (const uint8_t *)(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (!data)
+            throw std::runtime_error("failed to map file in class HFMView.");
+#else
+        const int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st))
+        {
+            if (fd >= 0)
+                close(fd);
+            throw std::runtime_error("failed to open file in class HFMView.");
+        }
+        length = std::size_t(st.st_size);
+        void *p = length ? mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+        close(fd);
+        if (p == MAP_FAILED)
+            throw std::runtime_error("failed to map file in class HFMView.");
+        data = (const uint8_t *)(p);
+#endif
+        return;
+    }
+
+    /** @brief read the header(s) of the file in [data, data + length) */
+    void parse()
+    {
+        const uint8_t *p = data, *const end = data + length;
+        if (length < sizeof(std::size_t))
+            throw std::invalid_argument("invalid file passed to class HFMView.");
+        const std::size_t l1 = HFMStream::load(p);
+        if (l1 == HFMStream::magic)
+        {
+            blocks = std::make_unique<HFMStream::Blocks>(data, end, threads);
+            return;
+        }
+        p += sizeof(std::size_t);
+        if (l1 == HFMTree::canonical_magic)
+            hfmtree = HFMTree(HFMTree::read_lengths(p, end));
+        else
+        {
+            if (std::size_t(end - p) < l1)
+                throw std::runtime_error("truncated file passed to class HFMView.");
+            hfmtree = HFMTree(p, p + l1);
+            p += l1;
+        }
+        if (std::size_t(end - p) < sizeof(std::size_t))
+            throw std::runtime_error("truncated file passed to class HFMView.");
+        l2 = HFMStream::load(p);
+        code = p + sizeof(std::size_t);
+        if (std::size_t(end - code) < HFMTree::bytes(l2))
+            throw std::runtime_error("truncated file passed to class HFMView.");
+        return;
+    }
+
+public:
+    /**
+     * @brief Construct a new HFMView object, mapping a *.hfmtree into memory and reading its header(s)
+     * @param path path of the *.hfmtree
+     * @param threads number of threads reading and decoding a *.hfmtree in blocks, defaults to HFMPool::default_threads()
+     */
+    explicit HFMView(const std::filesystem::path &path, const std::size_t &threads = HFMPool::default_threads())
+        : data(nullptr), length(0), mapped(true),
+#if defined(_WIN32)
+          file(INVALID_HANDLE_VALUE), mapping(nullptr),
+#endif
+          threads(threads), hfmtree(), code(nullptr), l2(0), blocks()
+    {
+        try
+        {
+            map(path);
+            parse();
+        }
+        catch (...)
+        {
+            unmap();
+            throw;
+        }
+    }
+    /**
+     * @brief Construct a new HFMView object over a *.hfmtree already in memory, e.g. read from a pipe, and read its header(s)
+     * @param begin beginning of the *.hfmtree, required to outlive the HFMView object
+     * @param end end of the *.hfmtree
+     * @param threads number of threads reading and decoding a *.hfmtree in blocks, defaults to HFMPool::default_threads()
+     */
+    HFMView(const uint8_t *begin, const uint8_t *end, const std::size_t &threads = HFMPool::default_threads())
+        : data(begin), length(std::size_t(end - begin)), mapped(false),
+#if defined(_WIN32)
+          file(INVALID_HANDLE_VALUE), mapping(nullptr),
+#endif
+          threads(threads), hfmtree(), code(nullptr), l2(0), blocks()
+    {
+        parse();
+    }
+    HFMView(const HFMView &) = delete;
+    HFMView &operator=(const HFMView &) = delete;
+    virtual ~HFMView() { unmap(); }
+
+    /** @brief upper bound of the size of decoded text, exact for a *.hfmtree in blocks */
+    std::size_t bound() const noexcept { return blocks ? blocks->size() : hfmtree.bound(l2); }
+    /** @brief HFMTree objects of the file in order */
+    std::vector<HFMTree> trees() const { return blocks ? blocks->trees() : std::vector<HFMTree>{hfmtree}; }
+    /**
+     * @brief check the checksums of a *.hfmtree in blocks without decoding it, e.g. scrubbing files in long-term storage
+     * @return std::size_t number of blocks with a checksum, all of them intact, 0 for files without checksums
+     */
+    std::size_t verify() const { return blocks ? blocks->verify(threads) : 0; }
+    /**
+     * @brief decode the file into a buffer
+     * @param buffer destination
+     * @param capacity size of the buffer, no less than bound() for a *.hfmtree in blocks
+     * @return std::size_t size of decoded text
+     */
+    std::size_t decode(char *buffer, const std::size_t &capacity) const
+    {
+        if (!blocks)
+            return l2 ? hfmtree.decode(code, code + HFMTree::bytes(l2), l2, buffer, capacity) : 0;
+        if (capacity < blocks->size())
+            throw std::invalid_argument("too small buffer passed to HFMView::decode.");
+        blocks->decode(buffer, threads);
+        return blocks->size();
+    }
+    /**
+     * @brief decode a single *.hfmtree bit by bit, walking its huffman tree, see HFMTree::decode_walk
+     * @return std::string decoded text
+     */
+    std::string decode_walk() const
+    {
+        if (blocks)
+            throw std::invalid_argument("*.hfmtree in blocks passed to HFMView::decode_walk.");
+        return l2 ? hfmtree.decode_walk(code, code + HFMTree::bytes(l2), l2) : std::string();
+    }
+    /**
+     * @brief decode characters [offset, offset + length) of the file only,
+     * a *.hfmtree in blocks is decoded from the nearest checkpoints of the blocks they are in, a single *.hfmtree from its beginning
+     * @param offset first character decoded
+     * @param length number of characters decoded at most
+     * @return std::string, shorter than length at the end of the text
+     */
+    std::string decode_range(const std::size_t &offset, const std::size_t &length) const
+    {
+        if (blocks)
+        {
+            std::string result(offset < blocks->size() ? std::min(length, blocks->size() - offset) : 0, '\0');
+            result.resize(blocks->decode_range(offset, length, result.data()));
+            return result;
+        }
+        const std::size_t bound = hfmtree.bound(l2);
+        if (offset >= bound || !l2)
+            return std::string();
+        std::string result(std::min(length, bound - offset), '\0');
+        result.resize(hfmtree.decode_range(code, code + HFMTree::bytes(l2), l2, std::span<const std::size_t>(), bound, offset,
+                                           result.data(), result.size()));
+        return result;
+    }
+};
+
+/**
+ * @brief
+ * registry of shared dictionaries, canonical codes trained once from samples and referenced by id from the messages they code,
+ * so that small messages are not preceded by a tree of their own, safe to be shared across threads
+ */
+class HFMDictionary
+{
+private:
+    mutable std::shared_mutex mutex;
+    std::unordered_map<uint64_t, std::shared_ptr<const HFMTree>> dictionaries;
+
+public:
+    /** @brief magic number starting a *.hfmdict, "HFMDICTS" in bytes */
+    constexpr static std::size_t magic = 0x53544349444d4648;
+
+    HFMDictionary() = default;
+    HFMDictionary(const HFMDictionary &) = delete;
+    HFMDictionary &operator=(const HFMDictionary &) = delete;
+    virtual ~HFMDictionary() = default;
+
+    /**
+     * @brief train a dictionary from a sample of messages
+     * every character is counted once more than in the sample, so that messages with characters absent from the sample are still coded
+     * @param sample characters counted in the sample
+     * @return HFMTree canonical codes of the dictionary
+     */
+    static inline HFMTree train(const HFMTree::Counter &sample) { return HFMStream::train_all(sample); }
+
+    /**
+     * @brief register a dictionary, nothing is changed if it has been registered
+     * @param tree HFMTree object, canonicalized when registered
+     * @return uint64_t id of the dictionary
+     */
+    uint64_t add(HFMTree tree)
+    {
+        tree.canonicalize();
+        const uint64_t id = tree.id();
+        std::unique_lock<std::shared_mutex> lock(mutex);
+        dictionaries.emplace(id, std::make_shared<const HFMTree>(std::move(tree)));
+        return id;
+    }
+    /**
+     * @brief get a registered dictionary
+     * @param id id of the dictionary
+     * @return std::shared_ptr<const HFMTree>
+     */
+    std::shared_ptr<const HFMTree> get(const uint64_t &id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        const auto it = dictionaries.find(id);
+        if (it == dictionaries.end())
+            throw std::invalid_argument("unknown dictionary passed to class HFMDictionary.");
+        return it->second;
+    }
+    /**
+     * @brief whether a dictionary is registered
+     * @param id id of the dictionary
+     */
+    bool contains(const uint64_t &id) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mutex);
+        return dictionaries.count(id);
+    }
+
+    /**
+     * @brief write a registered dictionary into a *.hfmdict
+     * @param id id of the dictionary
+     * @param p path of targeting file
+     */
+    void save(const uint64_t &id, const std::filesystem::path &p) const
+    {
+        const auto tree = get(id);
+        std::fstream o(p, std::ios::out | std::ios::binary);
+        o.write((const char *)(&magic), sizeof(std::size_t));
+        o.write((const char *)(&id), sizeof(uint64_t));
+        tree->write_lengths(o);
+        o.close();
+        return;
+    }
+    /**
+     * @brief register a dictionary from a *.hfmdict
+     * @param p path of the *.hfmdict
+     * @return uint64_t id of the dictionary
+     */
+    uint64_t load(const std::filesystem::path &p)
+    {
+        std::fstream i(p, std::ios::in | std::ios::binary);
+        std::size_t m = 0;
+        uint64_t id = 0;
+        i.read((char *)(&m), sizeof(std::size_t));
+        i.read((char *)(&id), sizeof(uint64_t));
+        if (!i || m != magic)
+            throw std::invalid_argument("invalid file passed to class HFMDictionary.");
+        HFMTree tree(HFMTree::read_lengths(i));
+        if (tree.id() != id)
+            throw std::runtime_error("corrupted file passed to class HFMDictionary.");
+        return add(std::move(tree));
+    }
+
+    /**
+     * @brief encode a message with a registered dictionary
+     * @param id id of the dictionary
+     * @param message message to be encoded
+     * @return std::vector<uint8_t> [id][l2][code], see message coded with a shared dictionary
+     */
+    std::vector<uint8_t> encode(const uint64_t &id, const std::string_view &message) const
+    {
+        const auto tree = get(id);
+        // a dictionary not trained by HFMDictionary::train may leave characters of messages without codes
+        if (!tree->codes(message))
+            throw std::invalid_argument("character without code passed to HFMDictionary::encode.");
+        auto code = tree->encode(message);
+        code.insert(code.begin(), (const uint8_t *)(&id), (const uint8_t *)(&id) + sizeof(uint64_t));
+        return code;
+    }
+    /**
+     * @brief decode a message coded with a registered dictionary
+     * @param begin beginning of the coded message
+     * @param end end of the coded message
+     * @return std::string
+     */
+    std::string decode(const uint8_t *begin, const uint8_t *end) const
+    {
+        if (std::size_t(end - begin) < sizeof(uint64_t) + sizeof(std::size_t))
+            throw std::invalid_argument("truncated message passed to class HFMDictionary.");
+        uint64_t id;
+        std::memcpy(&id, begin, sizeof(uint64_t));
+        const std::size_t l2 = HFMStream::load(begin + sizeof(uint64_t));
+        begin += sizeof(uint64_t) + sizeof(std::size_t);
+        if (std::size_t(end - begin) < HFMTree::bytes(l2))
+            throw std::invalid_argument("truncated message passed to class HFMDictionary.");
+        return get(id)->decode(begin, end, l2);
+    }
+    /**
+     * @brief decode a message coded with a registered dictionary
+     * @param code coded message
+     * @return std::string
+     */
+    inline std::string decode(const std::vector<uint8_t> &code) const { return decode(code.data(), code.data() + code.size()); }
+};
+
+/**
+ * @brief
+ * canonical codes with code lengths known at compile time, e.g. of a fixed protocol vocabulary,
+ * codes and the decode table are constexpr data, so that no tree is built at runtime and the hot loops see constant table sizes,
+ * code of HFMFixed<lengths> is the same as that of HFMTree(lengths)
+ * @tparam Lengths code length of each character, 0 for absent characters, complete, no longer than HFMFixed::max_length
+ */
+template <std::array<uint8_t, HFMTree::alphabet> Lengths>
+class HFMFixed
+{
+public:
+    /** @brief maximum length of a code, so that a code always fits in a refilled window */
+    constexpr static uint8_t max_length = 56;
+
+    /** @brief length of the longest code */
+    constexpr static uint8_t longest = []()
+    {
+        uint8_t l = 0;
+        for (const auto &i : Lengths)
+            l = std::max(l, i);
+        return l;
+    }();
+    /** @brief length of the shortest code */
+    constexpr static uint8_t shortest = []()
+    {
+        uint8_t l = 0;
+        for (const auto &i : Lengths)
+            l = (i && (!l || i < l)) ? i : l;
+        return l;
+    }();
+    static_assert(longest <= max_length, "too long code lengths passed to class HFMFixed.");
+    static_assert([]()
+                  {
+                      // Kraft sum, in units of 2^-max_length
+                      uint64_t sum = 0;
+                      std::size_t n = 0;
+                      for (const auto &i : Lengths)
+                          if (i)
+                          {
+                              sum += uint64_t(1) << (max_length - i);
+                              n++;
+                          }
+                      return n >= 2 && sum == (uint64_t(1) << max_length); }(),
+                  "incomplete or over-subscribed code lengths passed to class HFMFixed.");
+
+    /** @brief codes of all characters, assigned as HFMTree::generate_code(lengths) does */
+    constexpr static HFMTree::Codes code = []()
+    {
+        HFMTree::Codes c{};
+        uint64_t next = 0;
+        uint8_t last = 0;
+        bool first = true;
+        for (uint8_t l = 1; l <= longest; l++)
+            for (std::size_t i = 0; i < HFMTree::alphabet; i++)
+                if (Lengths[i] == l)
+                {
+                    if (!first)
+                        next++;
+                    next <<= l - last;
+                    c[i] = HFMTree::Code{next, l};
+                    last = l;
+                    first = false;
+                }
+        return c;
+    }();
+    /** @brief width of the decode table in bits, with room for a 2nd character after the longest codes, as HFMTree::Table */
+    constexpr static uint8_t width = std::min<uint8_t>(uint8_t(longest << 1), HFMTree::Table::bits);
+
+private:
+    using Entry = HFMTree::Table::Entry;
+
+    /** @brief decode table of HFMFixed::width bits, resolving 1 or 2 characters, length 0 for codes longer than that */
+    constexpr static std::array<Entry, (std::size_t(1) << width)> table = []()
+    {
+        std::array<Entry, (std::size_t(1) << width)> t{};
+        for (std::size_t i = 0; i < HFMTree::alphabet; i++)
+            if (code[i].length && code[i].length <= width)
+                for (std::size_t j = 0; j < (std::size_t(1) << (width - code[i].length)); j++)
+                    t[(code[i].bits << (width - code[i].length)) | j] = Entry{uint16_t(i), code[i].length, code[i].length};
+        // pairing in place keeps the first character and its length of an entry
+        for (std::size_t i = 0; i < t.size(); i++)
+        {
+            const Entry a = t[i];
+            if (!a.length || a.length >= width)
+                continue;
+            const Entry b = t[(i << a.length) & (t.size() - 1)];
+            if (b.length && b.length <= width - a.length)
+                t[i] = Entry{uint16_t(a.value | ((b.value & 0xff) << 8)), a.length, uint8_t(a.length + b.length)};
+        }
+        return t;
+    }();
+    /** @brief canonical decoding of codes longer than HFMFixed::width, codes of length l are limit[l] - count[l] to limit[l] - 1 */
+    struct Canonical
+    {
+        std::array<uint64_t, max_length + 1> limit;
+        std::array<uint16_t, max_length + 1> count, base;
+        /** @brief characters in ascending order of (length, character) */
+        std::array<uint8_t, HFMTree::alphabet> sorted;
+    };
+    constexpr static Canonical canonical = []()
+    {
+        Canonical c{};
+        std::size_t n = 0;
+        for (uint8_t l = 1; l <= longest; l++)
+        {
+            c.base[l] = uint16_t(n);
+            for (std::size_t i = 0; i < HFMTree::alphabet; i++)
+                if (Lengths[i] == l)
+                {
+                    c.count[l]++;
+                    c.sorted[n++] = uint8_t(i);
+                }
+            // codes of length l follow those of length l - 1 with a 0 appended
+            c.limit[l] = (c.limit[l - 1] << 1) + c.count[l];
+        }
+        return c;
+    }();
+
+    /**
+     * @brief the entry of the code at the top of a window
+     * @param window next bits of code, no less than HFMFixed::longest of them valid
+     * @return Entry
+     */
+    static inline Entry lookup(const uint64_t &window) noexcept
+    {
+        const Entry e = table[window >> (64 - width)];
+        if (longest <= width || e.length)
+            return e;
+        return lookup_long(window);
+    }
+    /**
+     * @brief the entry of a code longer than HFMFixed::width at the top of a window, by canonical decoding
+     * @param window next bits of code, no less than HFMFixed::longest of them valid
+     * @return Entry
+     */
+    static Entry lookup_long(const uint64_t window) noexcept
+    {
+        for (uint8_t l = width + 1;; l++)
+        {
+            const uint64_t v = window >> (64 - l);
+            if (v < canonical.limit[l])
+            {
+                const uint8_t s = canonical.sorted[canonical.base[l] + (v - (canonical.limit[l] - canonical.count[l]))];
+                return Entry{s, l, l};
+            }
+        }
+    }
+
+public:
+    /**
+     * @brief length of the code of a string
+     * @param string string to be encoded, containing characters with codes only
+     * @return std::size_t l2, in !!!bits!!!
+     */
+    static constexpr std::size_t measure(const std::string_view &string) noexcept
+    {
+        std::size_t l2 = 0;
+        for (const auto &i : string)
+            l2 += code[uint8_t(i)].length;
+        return l2;
+    }
+    /**
+     * @brief encode a string into a buffer, writing exactly (measure(string) + 7) / 8 bytes, see HFMTree::encode
+     * @param string string to be encoded
+     * @param out destination
+     */
+    static void encode(const std::string_view &string, uint8_t *out) noexcept
+    {
+        HFMTree::_encode(code, string, out);
+        return;
+    }
+    /**
+     * @brief encode a string
+     * @param string string to be encoded
+     * @return std::vector<uint8_t> [l2][code], as returned by HFMTree::encode
+     */
+    static std::vector<uint8_t> encode(const std::string_view &string)
+    {
+        for (const auto &i : string)
+            if (!code[uint8_t(i)].length)
+                throw std::invalid_argument("character without code passed to HFMFixed::encode.");
+        const std::size_t l2 = measure(string);
+        std::vector<uint8_t> result(sizeof(std::size_t) + ((l2 + 0b111) >> 3));
+        std::memcpy(&(result[0]), &l2, sizeof(std::size_t));
+        encode(string, result.data() + sizeof(std::size_t));
+        return result;
+    }
+    /**
+     * @brief decode into a buffer, until l2 bits of code are decoded or the buffer is full
+     * @param begin beginning of the code
+     * @param end end of the code
+     * @param l2 length of the code in !!!bits!!!
+     * @param buffer destination
+     * @param capacity size of the buffer
+     * @return std::size_t number of decoded characters
+     */
+    static std::size_t decode(const uint8_t *begin, const uint8_t *end, const std::size_t &l2, char *buffer, const std::size_t &capacity)
+    {
+        HFMTree::Reader<const uint8_t *> r(begin, end, l2, buffer, capacity);
+        // fast path, a refill leaves no less than 56 bits in the window, enough for lookups of constant count in the table,
+        // a code longer than HFMFixed::width, if any, is resolved after a refill of its own
+        constexpr uint8_t lookups = max_length / width;
+        while (end - r.i >= 8 && l2 - r.count >= 64 && r.last - r.out >= 64)
+        {
+            // rounds of a refill and lookups, a round taking no more than 7 bytes of input, 56 bits of code and 2 * lookups bytes of buffer
+            std::size_t rounds = std::min({std::size_t(end - r.i - 8) / 7 + 1, (l2 - r.count - 64) / 56 + 1,
+                                           std::size_t(r.last - r.out - 64) / (2 * lookups) + 1});
+            // state is copied into locals, so that it is kept in registers, stores to buffer may alias it otherwise
+            const uint8_t *i = r.i;
+            uint64_t window = r.window;
+            uint8_t avail = r.avail;
+            char *out = r.out;
+            bool stuck = false;
+            for (; rounds && !stuck; rounds--)
+            {
+                window |= HFMTree::load(i) >> avail;
+                i += (63 - avail) >> 3;
+                avail |= 56;
+                for (uint8_t j = 0; j < lookups; j++)
+                {
+                    const Entry e = table[window >> (64 - width)];
+                    // always false for codes no longer than width
+                    if (longest > width && !e.length)
+                    {
+                        stuck = true;
+                        break;
+                    }
+                    // both characters are stored, the 2nd one counted only for pairs
+                    out[0] = char(e.value & 0xff);
+                    out[1] = char(e.value >> 8);
+                    out += 1 + (e.total != e.length);
+                    window <<= e.total;
+                    avail -= e.total;
+                }
+            }
+            // bits consumed are bits loaded less bits left in the window
+            r.count += 8 * std::size_t(i - r.i) + r.avail - avail;
+            r.i = i, r.window = window, r.avail = avail, r.out = out;
+            if (stuck)
+            {
+                r.refill();
+                const Entry e = lookup_long(r.window);
+                if (r.count + e.length > l2)
+                    break;
+                *r.out++ = char(e.value & 0xff);
+                r.consume(e.length);
+            }
+        }
+        // careful path, a character at a time
+        while (!r.done())
+        {
+            r.refill();
+            const Entry e = lookup(r.window);
+            if (r.count + e.length > l2)
+                break;
+            *r.out++ = char(e.value & 0xff);
+            r.consume(e.length);
+        }
+        return std::size_t(r.out - buffer);
+    }
+    /**
+     * @brief decode a string encoded by encode(const std::string_view &string) or HFMTree(lengths).encode
+     * @param code [l2][code]
+     * @return std::string
+     */
+    static std::string decode(const std::vector<uint8_t> &code)
+    {
+        if (code.size() < sizeof(std::size_t))
+            throw std::runtime_error("invalid code passed to HFMFixed::decode.");
+        std::size_t l2;
+        std::memcpy(&l2, code.data(), sizeof(std::size_t));
+        if (code.size() - sizeof(std::size_t) < HFMTree::bytes(l2))
+            throw std::runtime_error("truncated code passed to HFMFixed::decode.");
+        std::string result(l2 / shortest, '\0');
+        result.resize(decode(code.data() + sizeof(std::size_t), code.data() + code.size(), l2, result.data(), result.size()));
+        return result;
+    }
+    /** @brief the HFMTree object of the same canonical codes, e.g. for writing a code-length header */
+    static HFMTree tree() { return HFMTree(std::vector<uint8_t>(Lengths.begin(), Lengths.end())); }
+};
+
+/**
+ * @brief
+ * order-1 context model, text coded with a code table chosen by the previous character,
+ * contexts too rare to pay for a code-length header of their own fall back to the order-0 codes of the whole text
+ */
+class HFMContext
+{
+private:
+    /** @brief code tables, the order-0 one first, canonical */
+    std::vector<HFMTree> trees;
+    /** @brief decode tables of HFMContext::trees, pairing characters with the tables of their contexts, see HFMContext::pair */
+    std::vector<HFMTree::Table> tables;
+    /** @brief index in HFMContext::trees of the table of each context (previous character) */
+    std::array<uint16_t, HFMTree::alphabet> model;
+
+    /** @brief helper class for HFMContext::decode, a decode table of HFMContext::tables */
+    struct Lookup
+    {
+        const HFMTree::Table::Entry *entries;
+        const std::size_t *links;
+        uint8_t width;
+    };
+
+    /** @brief read the model, helper function for HFMContext(const uint8_t *&p, const uint8_t *end) */
+    void read(const uint8_t *&p, const uint8_t *end)
+    {
+        if (std::size_t(end - p) < sizeof(std::size_t) + (HFMTree::alphabet >> 3) || HFMStream::load(p) != magic)
+            throw std::invalid_argument("invalid model passed to class HFMContext.");
+        p += sizeof(std::size_t);
+        const uint8_t *const own = p;
+        p += HFMTree::alphabet >> 3;
+        trees.emplace_back(HFMTree::read_lengths(p, end));
+        for (std::size_t c = 0; c < HFMTree::alphabet; c++)
+        {
+            model[c] = 0;
+            if ((own[c >> 3] >> (c & 0b111)) & 1)
+            {
+                model[c] = uint16_t(trees.size());
+                trees.emplace_back(HFMTree::read_lengths(p, end));
+            }
+        }
+        return;
+    }
+    /** @brief build HFMContext::tables from HFMContext::trees */
+    void build_tables()
+    {
+        tables.reserve(trees.size());
+        for (const auto &t : trees)
+            tables.emplace_back(t.code, std::pmr::get_default_resource(), false);
+        for (auto &t : tables)
+            pair(t);
+        return;
+    }
+    /**
+     * @brief let entries of a primary table resolve a 2nd character, with the table of the context of the 1st one,
+     * when its code fits in the remaining bits, as HFMTree::Table::pair does within a single table
+     * @param t table in HFMContext::tables
+     */
+    void pair(HFMTree::Table &t) const
+    {
+        const std::size_t size = std::size_t(1) << t.width, mask = size - 1;
+        // done in place, pairing keeps the first character and its length of an entry
+        for (std::size_t i = 0; i < size; i++)
+        {
+            const HFMTree::Table::Entry a = t.entries[i];
+            if (!a.length || a.length >= t.width)
+                continue;
+            const HFMTree::Table &u = tables[model[a.value & 0xff]];
+            const std::size_t next = (i << a.length) & mask;
+            const HFMTree::Table::Entry &b = u.entries[u.width <= t.width ? next >> (t.width - u.width) : next << (u.width - t.width)];
+            if (b.length && b.length <= t.width - a.length)
+                t.entries[i] = HFMTree::Table::Entry{uint16_t(a.value | ((b.value & 0xff) << 8)), a.length, uint8_t(a.length + b.length)};
+        }
+        return;
+    }
+
+public:
+    /** @brief magic number starting a model, "HFMORDR1" in bytes */
+    constexpr static std::size_t magic = 0x315244524f4d4648;
+
+    /**
+     * @brief Construct a new HFMContext object, training the model with text,
+     * a context gets a code table of its own when the bits it saves pay for its code-length header
+     * @param text training text, containing at least 2 different characters
+     */
+    explicit HFMContext(const std::string_view &text) : trees(), tables(), model()
+    {
+        std::vector<HFMTree::Counter> counters(HFMTree::alphabet);
+        for (std::size_t k = 1; k < text.size(); k++)
+            counters[uint8_t(text[k - 1])][uint8_t(text[k])]++;
+        trees.emplace_back(HFMTree(HFMTree::Counter(text)).canonicalize());
+        for (std::size_t c = 0; c < HFMTree::alphabet; c++)
+        {
+            HFMTree::Counter &counter = counters[c];
+            std::size_t fallback = 0, distinct = 0, only = 0;
+            for (std::size_t s = 0; s < HFMTree::alphabet; s++)
+                if (counter[s])
+                {
+                    fallback += counter[s] * trees[0].code[s].length;
+                    distinct++, only = s;
+                }
+            if (!distinct)
+                continue;
+            // a context always followed by the same character still needs a 2nd one for a tree
+            if (distinct == 1)
+                counter[(only + 1) % HFMTree::alphabet] = 1;
+            HFMTree tree = HFMTree(counter).canonicalize();
+            std::size_t own = 0;
+            for (std::size_t s = 0; s < HFMTree::alphabet; s++)
+                own += (distinct == 1 && s != only) ? 0 : counter[s] * tree.code[s].length;
+            std::ostringstream header;
+            own += tree.write_lengths(header) << 3;
+            if (own < fallback)
+            {
+                model[c] = uint16_t(trees.size());
+                trees.emplace_back(std::move(tree));
+            }
+        }
+        build_tables();
+    }
+    /**
+     * @brief Construct a new HFMContext object from a model written by HFMContext::write
+     * @param p pointer to the model, moved to the end of the model
+     * @param end end of readable bytes
+     */
+    HFMContext(const uint8_t *&p, const uint8_t *end) : trees(), tables(), model()
+    {
+        read(p, end);
+        build_tables();
+    }
+    HFMContext(const HFMContext &) = default;
+    HFMContext(HFMContext &&) = default;
+    HFMContext &operator=(const HFMContext &) = default;
+    HFMContext &operator=(HFMContext &&) = default;
+    virtual ~HFMContext() = default;
+
+    /** @brief number of contexts with a code table of their own */
+    inline std::size_t contexts() const noexcept { return trees.size() - 1; }
+    /**
+     * @brief write the model, [magic][32 bytes, bit c set for context c having a code-length header]
+     * [order-0 code-length header][code-length header of each of those contexts]
+     * @param o std::ostream, required to be opened in binary mode
+     * @return std::size_t size of the model in bytes
+     */
+    std::size_t write(std::ostream &o) const
+    {
+        std::array<uint8_t, (HFMTree::alphabet >> 3)> own{};
+        for (std::size_t c = 0; c < HFMTree::alphabet; c++)
+            if (model[c])
+                own[c >> 3] |= uint8_t(1 << (c & 0b111));
+        o.write((const char *)(&magic), sizeof(std::size_t));
+        o.write((const char *)(own.data()), own.size());
+        std::size_t size = sizeof(std::size_t) + own.size() + trees[0].write_lengths(o);
+        for (std::size_t c = 0; c < HFMTree::alphabet; c++)
+            if (model[c])
+                size += trees[model[c]].write_lengths(o);
+        return size;
+    }
+
+    /**
+     * @brief length of the code of a text
+     * @param text text to be encoded
+     * @return std::size_t length in !!!bits!!!
+     */
+    std::size_t measure(const std::string_view &text) const
+    {
+        std::size_t l2 = 0;
+        for (std::size_t k = 0; k < text.size(); k++)
+        {
+            const uint8_t l = trees[k ? model[uint8_t(text[k - 1])] : 0].code[uint8_t(text[k])].length;
+            if (!l)
+                throw std::invalid_argument("character not coded in its context passed to HFMContext::encode.");
+            l2 += l;
+        }
+        return l2;
+    }
+    /**
+     * @brief encode a text, the first character with the order-0 codes, every other one with the codes of its context
+     * @param text text to be encoded, every character of which coded in its context
+     * @return std::vector<uint8_t> [l0][l2][code]
+     */
+    std::vector<uint8_t> encode(const std::string_view &text) const
+    {
+        const std::size_t l0 = text.size(), l2 = measure(text);
+        std::vector<uint8_t> result(2 * sizeof(std::size_t) + ((l2 + 0b111) >> 3));
+        std::memcpy(&(result[0]), &l0, sizeof(std::size_t));
+        std::memcpy(&(result[sizeof(std::size_t)]), &l2, sizeof(std::size_t));
+        uint8_t *out = result.data() + 2 * sizeof(std::size_t);
+        std::array<const HFMTree::Code *, HFMTree::alphabet> codes;
+        for (std::size_t c = 0; c < HFMTree::alphabet; c++)
+            codes[c] = trees[model[c]].code.data();
+        // pending bits are kept at the top of cache, used of them are valid
+        uint64_t cache = 0;
+        uint8_t used = 0;
+        const HFMTree::Code *code = trees[0].code.data();
+        for (const auto &i : text)
+        {
+            const HFMTree::Code &c = code[uint8_t(i)];
+            code = codes[uint8_t(i)];
+            if (used + c.length < 64)
+            {
+                cache |= c.bits << (64 - used - c.length);
+                used += c.length;
+            }
+            else
+            {
+                const uint8_t rest = used + c.length - 64;
+                cache |= c.bits >> rest;
+                HFMTree::store(out, cache);
+                out += sizeof(uint64_t);
+                cache = rest ? c.bits << (64 - rest) : 0;
+                used = rest;
+            }
+        }
+        for (; used; used = (used > 8) ? used - 8 : 0, cache <<= 8)
+            *out++ = uint8_t(cache >> 56);
+        return result;
+    }
+    /**
+     * @brief decode a text encoded by HFMContext::encode
+     * @param begin beginning of [l0][l2][code]
+     * @param end end of the code
+     * @return std::string
+     */
+    std::string decode(const uint8_t *begin, const uint8_t *end) const
+    {
+        if (std::size_t(end - begin) < 2 * sizeof(std::size_t))
+            throw std::invalid_argument("truncated code passed to HFMContext::decode.");
+        const std::size_t l0 = HFMStream::load(begin), l2 = HFMStream::load(begin + sizeof(std::size_t));
+        begin += 2 * sizeof(std::size_t);
+        if (std::size_t(end - begin) < HFMTree::bytes(l2) || l0 > l2)
+            throw std::invalid_argument("truncated code passed to HFMContext::decode.");
+        std::string result(l0, '\0');
+        // decode tables of each context, then of the first character, one lookup away from the character decoded
+        std::array<Lookup, HFMTree::alphabet + 1> lookup;
+        for (std::size_t c = 0; c <= HFMTree::alphabet; c++)
+        {
+            const HFMTree::Table &table = tables[c < HFMTree::alphabet ? model[c] : 0];
+            lookup[c] = Lookup{table.entries.data(), table.links.data(), table.width};
+        }
+        HFMTree::Reader<const uint8_t *> r(begin, end, l2, result.data(), result.size());
+        const Lookup *t = &lookup[HFMTree::alphabet];
+        for (;;)
+        {
+            // fast path, as long as 8 bytes of input and 64 bits of code are left, until a code longer than the primary table,
+            // state is copied into locals, so that it is kept in registers, stores to result may alias it otherwise
+            const uint8_t *i = r.i;
+            uint64_t window = r.window;
+            uint8_t avail = r.avail;
+            std::size_t count = r.count;
+            char *out = r.out;
+            while (end - i >= 8 && l2 - count >= 64 && r.last - out >= 2)
+            {
+                window |= HFMTree::load(i) >> avail;
+                i += (63 - avail) >> 3;
+                avail |= 56;
+                const HFMTree::Table::Entry e = t->entries[window >> (64 - t->width)];
+                if (!e.length)
+                    break;
+                // both characters are stored, the 2nd one counted only for pairs
+                out[0] = char(e.value & 0xff);
+                out[1] = char(e.value >> 8);
+                const bool paired = e.total != e.length;
+                out += 1 + paired;
+                window <<= e.total;
+                avail -= e.total;
+                count += e.total;
+                t = &lookup[uint8_t(e.value >> (paired << 3))];
+            }
+            r.i = i, r.window = window, r.avail = avail, r.count = count, r.out = out;
+            if (r.done())
+                break;
+            // careful path, a character at a time, resolving codes longer than the primary table, pairs are not taken
+            r.refill();
+            HFMTree::Table::Entry e = t->entries[r.window >> (64 - t->width)];
+            uint8_t w = t->width;
+            while (!e.length)
+            {
+                if (!e.total)
+                    throw std::runtime_error("invalid code passed to HFMContext::decode.");
+                r.consume(w);
+                r.refill();
+                w = e.total;
+                e = t->entries[t->links[e.value] + (r.window >> (64 - w))];
+            }
+            if (r.count + e.length > r.l2)
+                break;
+            *r.out++ = char(e.value & 0xff);
+            r.consume(e.length);
+            t = &lookup[uint8_t(e.value & 0xff)];
+        }
+        if (r.out != r.last || r.count != l2)
+            throw std::runtime_error("corrupted code passed to HFMContext::decode.");
+        return result;
+    }
+    /**
+     * @brief decode a text encoded by HFMContext::encode
+     * @param code [l0][l2][code]
+     * @return std::string
+     */
+    inline std::string decode(const std::vector<uint8_t> &code) const { return decode(code.data(), code.data() + code.size()); }
+
+    /**
+     * @brief compress a text with a model trained with itself
+     * @param text text to be compressed, containing at least 2 different characters
+     * @return std::vector<uint8_t> [model][l0][l2][code], see order-1 context model
+     */
+    static std::vector<uint8_t> compress(const std::string_view &text)
+    {
+        const HFMContext context(text);
+        std::ostringstream o(std::ios::out | std::ios::binary);
+        context.write(o);
+        const std::string model = o.str();
+        std::vector<uint8_t> code = context.encode(text);
+        code.insert(code.begin(), model.begin(), model.end());
+        return code;
+    }
+    /**
+     * @brief decompress a text compressed by HFMContext::compress
+     * @param begin beginning of [model][l0][l2][code]
+     * @param end end of the code
+     * @return std::string
+     */
+    static std::string decompress(const uint8_t *begin, const uint8_t *end)
+    {
+        const HFMContext context(begin, end);
+        return context.decode(begin, end);
+    }
+    /**
+     * @brief decompress a text compressed by HFMContext::compress
+     * @param code [model][l0][l2][code]
+     * @return std::string
+     */
+    static inline std::string decompress(const std::vector<uint8_t> &code) { return decompress(code.data(), code.data() + code.size()); }
+};
+
+/**
+ * @brief
+ * batch of strings coded into one contiguous arena, item k taking bytes [offsets[k], offsets[k + 1]) of it,
+ * each item recorded as [l2][code] as returned by HFMTree::encode, so that fixed costs are paid once per batch
+ */
+class HFMBatch
+{
+private:
+    std::vector<uint8_t> arena;
+    std::vector<std::size_t> offsets;
+
+    /**
+     * @brief encode strings into the arena, helper function for HFMBatch::encode
+     * @param strings strings to be encoded
+     * @param tree HFMTree object used for item k
+     * @param threads number of threads
+     */
+    template <typename Tree>
+    static HFMBatch _encode(const std::span<const std::string_view> &strings, const Tree &tree, const std::size_t &threads)
+    {
+        HFMBatch batch;
+        std::vector<std::size_t> l2(strings.size());
+        // measure counts characters without a code as 0 bits, their items would decode truncated
+        HFMPool::run(strings.size(), threads, [&](const std::size_t &k)
+                     {
+                         if (!tree(k).codes(strings[k]))
+                             throw std::invalid_argument("character without code passed to HFMBatch::encode.");
+                         l2[k] = tree(k).measure(strings[k]); });
+
+        batch.offsets.resize(strings.size() + 1);
+        for (std::size_t k = 0; k < strings.size(); k++)
+            batch.offsets[k + 1] = batch.offsets[k] + sizeof(std::size_t) + ((l2[k] + 0b111) >> 3);
+        batch.arena.resize(batch.offsets.back());
+        HFMPool::run(strings.size(), threads, [&](const std::size_t &k)
+                     {
+                         uint8_t *p = batch.arena.data() + batch.offsets[k];
+                         std::memcpy(p, &(l2[k]), sizeof(std::size_t));
+                         tree(k).encode(strings[k], p + sizeof(std::size_t)); });
+        return batch;
+    }
+    /**
+     * @brief decode items of the arena, helper function for HFMBatch::decode
+     * @param tree HFMTree object used for item k
+     * @param text decoded items, concatenated
+     * @param offsets item k taking characters [offsets[k], offsets[k + 1]) of text
+     * @param threads number of threads
+     */
+    template <typename Tree>
+    void _decode(const Tree &tree, std::string &text, std::vector<std::size_t> &offsets, const std::size_t &threads) const
+    {
+        const std::size_t n = size();
+        std::vector<std::size_t> l2(n), bound(n + 1), length(n);
+        for (std::size_t k = 0; k < n; k++)
+        {
+            if (this->offsets[k + 1] - this->offsets[k] < sizeof(std::size_t))
+                throw std::runtime_error("corrupted batch passed to HFMBatch::decode.");
+            std::memcpy(&(l2[k]), arena.data() + this->offsets[k], sizeof(std::size_t));
+            if (this->offsets[k + 1] - this->offsets[k] - sizeof(std::size_t) < HFMTree::bytes(l2[k]))
+                throw std::runtime_error("corrupted batch passed to HFMBatch::decode.");
+            bound[k + 1] = bound[k] + tree(k).bound(l2[k]);
+        }
+        text.resize(bound.back());
+        HFMPool::run(n, threads, [&](const std::size_t &k)
+                     {
+                         const uint8_t *p = arena.data() + this->offsets[k] + sizeof(std::size_t);
+                         length[k] = l2[k] ? tree(k).decode(p, arena.data() + this->offsets[k + 1], l2[k], text.data() + bound[k], bound[k + 1] - bound[k]) : 0; });
+        // items are decoded into slots of their bounds, then packed
+        offsets.assign(n + 1, 0);
+        for (std::size_t k = 0; k < n; k++)
+        {
+            std::memmove(text.data() + offsets[k], text.data() + bound[k], length[k]);
+            offsets[k + 1] = offsets[k] + length[k];
+        }
+        text.resize(offsets.back());
+        return;
+    }
+
+public:
+    HFMBatch() = default;
+    HFMBatch(const HFMBatch &) = default;
+    HFMBatch(HFMBatch &&) = default;
+    /**
+     * @brief Construct a new HFMBatch object from an arena written before
+     * @param arena items, each recorded as [l2][code]
+     * @param offsets item k taking bytes [offsets[k], offsets[k + 1]) of arena
+     */
+    HFMBatch(std::vector<uint8_t> arena, std::vector<std::size_t> offsets) : arena(std::move(arena)), offsets(std::move(offsets))
+    {
+        if (!this->offsets.empty() && (this->offsets.front() || this->offsets.back() != this->arena.size() ||
+                                       !std::is_sorted(this->offsets.begin(), this->offsets.end())))
+            throw std::invalid_argument("invalid offsets passed to class HFMBatch.");
+    }
+    HFMBatch &operator=(const HFMBatch &) = default;
+    HFMBatch &operator=(HFMBatch &&) = default;
+    virtual ~HFMBatch() = default;
+
+    /**
+     * @brief encode strings with a shared HFMTree object
+     * @param tree HFMTree object
+     * @param strings strings to be encoded
+     * @param threads number of threads, defaults to 1
+     * @return HFMBatch
+     */
+    static HFMBatch encode(const HFMTree &tree, const std::span<const std::string_view> &strings, const std::size_t &threads = 1)
+    {
+        return _encode(strings, [&](const std::size_t &) -> const HFMTree & { return tree; }, threads);
+    }
+    /**
+     * @brief encode strings, each with a HFMTree object of its own
+     * @param trees HFMTree objects, trees[k] for strings[k]
+     * @param strings strings to be encoded
+     * @param threads number of threads, defaults to 1
+     * @return HFMBatch
+     */
+    static HFMBatch encode(const std::span<const HFMTree> &trees, const std::span<const std::string_view> &strings, const std::size_t &threads = 1)
+    {
+        if (trees.size() != strings.size())
+            throw std::invalid_argument("mismatched trees and strings passed to HFMBatch::encode.");
+        return _encode(strings, [&](const std::size_t &k) -> const HFMTree & { return trees[k]; }, threads);
+    }
+    /**
+     * @brief decode all items with a shared HFMTree object
+     * @param tree HFMTree object
+     * @param text decoded items, concatenated
+     * @param offsets item k taking characters [offsets[k], offsets[k + 1]) of text
+     * @param threads number of threads, defaults to 1
+     */
+    void decode(const HFMTree &tree, std::string &text, std::vector<std::size_t> &offsets, const std::size_t &threads = 1) const
+    {
+        _decode([&](const std::size_t &) -> const HFMTree & { return tree; }, text, offsets, threads);
+        return;
+    }
+    /**
+     * @brief decode all items, each with a HFMTree object of its own
+     * @param trees HFMTree objects, trees[k] for item k
+     * @param text decoded items, concatenated
+     * @param offsets item k taking characters [offsets[k], offsets[k + 1]) of text
+     * @param threads number of threads, defaults to 1
+     */
+    void decode(const std::span<const HFMTree> &trees, std::string &text, std::vector<std::size_t> &offsets, const std::size_t &threads = 1) const
+    {
+        if (trees.size() != size())
+            throw std::invalid_argument("mismatched trees passed to HFMBatch::decode.");
+        _decode([&](const std::size_t &k) -> const HFMTree & { return trees[k]; }, text, offsets, threads);
+        return;
+    }
+
+    /** @brief number of items */
+    inline std::size_t size() const noexcept { return offsets.empty() ? 0 : offsets.size() - 1; }
+    /** @brief the arena holding all items */
+    inline const std::vector<uint8_t> &data() const noexcept { return arena; }
+    /** @brief offsets of items in the arena, size() + 1 of them */
+    inline const std::vector<std::size_t> &bounds() const noexcept { return offsets; }
+    /**
+     * @brief item k, [l2][code] as returned by HFMTree::encode
+     * @param k index of the item
+     * @return std::span<const uint8_t>
+     */
+    inline std::span<const uint8_t> operator[](const std::size_t &k) const noexcept
+    {
+        return std::span<const uint8_t>(arena.data() + offsets[k], offsets[k + 1] - offsets[k]);
+    }
+};
+
+/**
+ * @brief
+ * adaptive huffman coder (FGK), updating the tree after every character coded, so that text is coded in a single pass
+ * without being buffered and without a header, see adaptive stream
+ */
+class HFMAdaptive
+{
+public:
+    /** @brief symbol ending an adaptive stream */
+    constexpr static uint16_t eos = 256;
+    /** @brief symbol marking a flush, the rest of its byte is padded */
+    constexpr static uint16_t sync = 257;
+    /** @brief number of symbols, characters, HFMAdaptive::eos and HFMAdaptive::sync */
+    constexpr static uint16_t symbols = 258;
+    class Encoder;
+    class Decoder;
+
+private:
+    /** @brief tree of an adaptive stream, shared by the encoder and the decoder */
+    class Model
+    {
+        friend class HFMAdaptive::Encoder;
+        friend class HFMAdaptive::Decoder;
+
+    private:
+        /** @brief node of the tree, nodes are numbered in the order of FGK, parent of a number is fixed while nodes swap */
+        struct Node
+        {
+            /** @brief marking a node to be internal or a symbol to be absent */
+            constexpr static uint16_t none = 0xffff;
+            std::size_t weight;
+            uint16_t parent, left, right, symbol;
+        };
+        // leaves of all symbols and the NYT leaf
+        constexpr static uint16_t root = 2 * symbols;
+
+        std::array<Node, 2 * symbols + 1> nodes;
+        std::array<uint16_t, symbols> leaf;
+        uint16_t nyt;
+
+        /**
+         * @brief swap the subtrees at numbers a and b, neither of them containing the other
+         * @param a number of a node
+         * @param b number of a node
+         */
+        void swap(const uint16_t &a, const uint16_t &b) noexcept
+        {
+            std::swap(nodes[a].weight, nodes[b].weight);
+            std::swap(nodes[a].left, nodes[b].left);
+            std::swap(nodes[a].right, nodes[b].right);
+            std::swap(nodes[a].symbol, nodes[b].symbol);
+            for (const uint16_t &n : {a, b})
+            {
+                if (nodes[n].symbol != Node::none)
+                    leaf[nodes[n].symbol] = n;
+                else
+                    nodes[nodes[n].left].parent = nodes[nodes[n].right].parent = n;
+            }
+            return;
+        }
+        /**
+         * @brief count a symbol once more, keeping the sibling property of the tree
+         * a new symbol splits the NYT leaf into the new NYT leaf and its own
+         * @param symbol symbol
+         */
+        void update(const uint16_t &symbol) noexcept
+        {
+            uint16_t n = leaf[symbol];
+            if (n == Node::none)
+            {
+                const uint16_t old = nyt;
+                nyt = old - 2;
+                n = old - 1;
+                nodes[nyt] = Node{0, old, Node::none, Node::none, Node::none};
+                nodes[n] = Node{0, old, Node::none, Node::none, symbol};
+                nodes[old].left = nyt;
+                nodes[old].right = n;
+                nodes[old].symbol = Node::none;
+                leaf[symbol] = n;
+            }
+            while (true)
+            {
+                // the leader of the block of nodes with the same weight, which is never the parent
+                uint16_t m = n;
+                while (m < root && nodes[m + 1].weight == nodes[n].weight)
+                    m++;
+                if (m == nodes[n].parent)
+                    m--;
+                if (m != n)
+                {
+                    swap(n, m);
+                    n = m;
+                }
+                nodes[n].weight++;
+                if (n == root)
+                    break;
+                n = nodes[n].parent;
+            }
+            return;
+        }
+
+    public:
+        Model() : nodes(), leaf(), nyt(root)
+        {
+            leaf.fill(Node::none);
+            nodes[root] = Node{0, Node::none, Node::none, Node::none, Node::none};
+        }
+    };
+
+public:
+    /** @brief single-pass encoder writing an adaptive stream */
+    class Encoder
+    {
+    private:
+        Model model;
+        std::ostream &o;
+        std::string buffer;
+        // pending bits are kept at the bottom of cache, used of them are valid
+        uint64_t cache;
+        uint8_t used;
+        bool closed;
+
+        /**
+         * @brief append bits to the stream
+         * @param bits bits, at the bottom
+         * @param length number of bits, no more than 56
+         */
+        inline void put(const uint64_t &bits, const uint8_t &length)
+        {
+            cache = (cache << length) | bits;
+            used += length;
+            for (; used >= 8; used -= 8)
+                buffer.push_back(char(cache >> (used - 8)));
+            cache &= (uint64_t(1) << used) - 1;
+            return;
+        }
+        /**
+         * @brief code a symbol, then count it
+         * @param symbol symbol
+         */
+        void put(const uint16_t &symbol)
+        {
+            uint16_t n = model.leaf[symbol];
+            const bool fresh = (n == Model::Node::none);
+            if (fresh)
+                n = model.nyt;
+            // the path is collected from the leaf up, then written from the Model::root down
+            std::array<uint64_t, (Model::root >> 6) + 1> path{};
+            uint16_t length = 0;
+            for (; n != Model::root; n = model.nodes[n].parent, length++)
+                path[length >> 6] |= uint64_t(model.nodes[model.nodes[n].parent].right == n) << (length & 0b111111);
+            while (length)
+            {
+                length--;
+                put((path[length >> 6] >> (length & 0b111111)) & 1, 1);
+            }
+            if (fresh)
+                put(symbol, 9);
+            model.update(symbol);
+            return;
+        }
+        /** @brief pad the last byte with zeros and hand the buffer to std::ostream */
+        void drain()
+        {
+            if (used)
+                put(0, 8 - used);
+            o.write(buffer.data(), buffer.size());
+            buffer.clear();
+            o.flush();
+            return;
+        }
+
+    public:
+        /**
+         * @brief Construct a new Encoder object
+         * @param o std::ostream, required to be opened in binary mode
+         */
+        explicit Encoder(std::ostream &o) : model(), o(o), buffer(), cache(0), used(0), closed(false) {}
+        Encoder(const Encoder &) = delete;
+        Encoder &operator=(const Encoder &) = delete;
+        virtual ~Encoder()
+        {
+            try
+            {
+                close();
+            }
+            catch (...)
+            {
+            }
+        }
+
+        /**
+         * @brief code text
+         * @param text text to be coded
+         */
+        void write(const std::string_view &text)
+        {
+            if (closed)
+                throw std::runtime_error("closed stream passed to HFMAdaptive::Encoder.");
+            for (const auto &c : text)
+            {
+                put(uint16_t(uint8_t(c)));
+                if (buffer.size() >= 0x1000)
+                {
+                    o.write(buffer.data(), buffer.size());
+                    buffer.clear();
+                }
+            }
+            return;
+        }
+        /** @brief code HFMAdaptive::sync and flush, so that everything written so far is decodable at once */
+        void flush()
+        {
+            if (closed)
+                throw std::runtime_error("closed stream passed to HFMAdaptive::Encoder.");
+            put(sync);
+            drain();
+            return;
+        }
+        /** @brief code HFMAdaptive::eos and flush, nothing can be written after this */
+        void close()
+        {
+            if (closed)
+                return;
+            closed = true;
+            put(eos);
+            drain();
+            return;
+        }
+    };
+
+    /** @brief single-pass decoder reading an adaptive stream, never reading beyond the byte of a flush */
+    class Decoder
+    {
+    private:
+        Model model;
+        std::istream &i;
+        // the current byte, left of its bits unread
+        uint8_t byte, left;
+        bool ended;
+
+        /**
+         * @brief read bits from the stream
+         * @param length number of bits, no more than 9
+         * @return uint16_t
+         */
+        uint16_t get(const uint8_t &length)
+        {
+            uint16_t bits = 0;
+            for (uint8_t k = 0; k < length; k++)
+            {
+                if (!left)
+                {
+                    const auto c = i.rdbuf()->sbumpc();
+                    if (c == std::char_traits<char>::eof())
+                        throw std::runtime_error("truncated stream passed to HFMAdaptive::Decoder.");
+                    byte = uint8_t(c);
+                    left = 8;
+                }
+                left--;
+                bits = uint16_t((bits << 1) | ((byte >> left) & 1));
+            }
+            return bits;
+        }
+        /** @brief decode a symbol, then count it */
+        uint16_t get()
+        {
+            uint16_t n = Model::root;
+            while (n != model.nyt && model.nodes[n].symbol == Model::Node::none)
+                n = get(1) ? model.nodes[n].right : model.nodes[n].left;
+            const uint16_t symbol = (n == model.nyt) ? get(9) : model.nodes[n].symbol;
+            if (symbol >= symbols)
+                throw std::runtime_error("invalid code passed to HFMAdaptive::Decoder.");
+            model.update(symbol);
+            return symbol;
+        }
+
+    public:
+        /**
+         * @brief Construct a new Decoder object
+         * @param i std::istream, required to be opened in binary mode
+         */
+        explicit Decoder(std::istream &i) : model(), i(i), byte(0), left(0), ended(false) {}
+        Decoder(const Decoder &) = delete;
+        Decoder &operator=(const Decoder &) = delete;
+        virtual ~Decoder() = default;
+
+        /** @brief whether HFMAdaptive::eos has been decoded */
+        inline bool eof() const noexcept { return ended; }
+        /**
+         * @brief decode text until the buffer is full, a flush is met, or the stream ends
+         * @param buffer destination
+         * @param capacity size of the buffer
+         * @return std::size_t size of decoded text
+         */
+        std::size_t read(char *buffer, const std::size_t &capacity)
+        {
+            std::size_t count = 0;
+            while (!ended && count < capacity)
+            {
+                const uint16_t symbol = get();
+                if (symbol < HFMTree::alphabet)
+                    buffer[count++] = char(symbol);
+                else
+                {
+                    left = 0;
+                    ended = (symbol == eos);
+                    if (count)
+                        break;
+                }
+            }
+            return count;
+        }
+    };
+
+    /**
+     * @brief compress text into an adaptive stream
+     * @param i std::istream of text, required to be opened in binary mode
+     * @param o std::ostream, required to be opened in binary mode
+     */
+    static void compress(std::istream &i, std::ostream &o)
+    {
+        Encoder encoder(o);
+        std::vector<char> buffer(0x10000);
+        while (i.read(buffer.data(), buffer.size()) || i.gcount())
+            encoder.write(std::string_view(buffer.data(), std::size_t(i.gcount())));
+        encoder.close();
+        return;
+    }
+    /**
+     * @brief decompress an adaptive stream
+     * @param i std::istream of an adaptive stream, required to be opened in binary mode
+     * @param o std::ostream, required to be opened in binary mode
+     */
+    static void decompress(std::istream &i, std::ostream &o)
+    {
+        Decoder decoder(i);
+        std::vector<char> buffer(0x10000);
+        while (!decoder.eof())
+            o.write(buffer.data(), decoder.read(buffer.data(), buffer.size()));
+        return;
+    }
+};
+
+class HFMString
+{
+private:
+    std::string string;
+    HFMTree hfmtree;
+    std::vector<uint8_t> code;
+
+public:
+    HFMString() = default;
+    HFMString(const HFMString &) = default;
+    HFMString(HFMString &&) = default;
+    HFMString(const std::string &s) : string(s), hfmtree(string), code(hfmtree.encode(string)) {}
+    HFMString(std::string &&s) : string(std::move(s)), hfmtree(string), code(hfmtree.encode(string)) {}
+    HFMString(const char *s) : string(s), hfmtree(string), code(hfmtree.encode(string)) {}
+    HFMString(const HFMTree &h, const std::string &s) : string(s), hfmtree(h), code(hfmtree.encode(string)) {}
+    HFMString(HFMTree &&h, const std::string &s) : string(s), hfmtree(std::move(h)), code(hfmtree.encode(string)) {}
+    HFMString(const HFMTree &h, std::string &&s) : string(std::move(s)), hfmtree(h), code(hfmtree.encode(string)) {}
+    HFMString(HFMTree &&h, std::string &&s) : string(std::move(s)), hfmtree(std::move(h)), code(hfmtree.encode(string)) {}
+    /**
+     * @brief Construct a new HFMString object from a *.txt or a *.hfmtree file
+     * a *.hfmtree is mapped into memory with HFMView and decoded straight into HFMString::string,
+     * HFMString::code is left empty until it is written
+     * @param path path of the file
+     * @param threads number of threads decoding a *.hfmtree in blocks, defaults to HFMPool::default_threads()
+     */
+    HFMString(const std::filesystem::path &path, const std::size_t &threads = HFMPool::default_threads())
+    {
+        const std::string mode(path.extension().string());
+        if (mode == ".hfmtree")
+        {
+            const HFMView view(path, threads);
+            string.resize(view.bound());
+            string.resize(view.decode(string.data(), string.size()));
+            auto trees = view.trees();
+            if (trees.size() == 1)
+                hfmtree = std::move(trees[0]);
+            else if (!string.empty())
+                hfmtree = HFMStream::train(string);
+        }
+        else if (mode == ".txt")
+        {
+            std::fstream i(path, std::ios::in);
+            string = std::string(std::istreambuf_iterator<char>(i), std::istreambuf_iterator<char>());
+            hfmtree = HFMTree(string);
+            code = hfmtree.encode(string);
+        }
+        else
+            throw std::invalid_argument("invalid file used to construct a HFMString object");
+    }
+    virtual ~HFMString() = default;
+    operator std::string() const & { return string; }
+    operator std::string() && { return std::move(string); }
+    HFMString &operator=(const HFMString &) = default;
+    HFMString &operator=(HFMString &&) = default;
+    /** @brief the text, without a copy */
+    inline const std::string &str() const noexcept { return string; }
+    /** @brief the HFMTree object */
+    inline const HFMTree &tree() const noexcept { return hfmtree; }
+    /** @brief bits per character the text is coded in, compared with HFMTree::Counter::entropy() of the text */
+    double bits_per_symbol() const
+    {
+        if (string.empty())
+            return 0;
+        return hfmtree.average_length(HFMTree::Counter(string));
+    }
+
+    /**
+     * @brief switch to canonical codes, so that the HFMString object is written with a code-length header
+     * @return HFMString&
+     */
+    HFMString &canonicalize()
+    {
+        if (!hfmtree.is_canonical())
+        {
+            hfmtree.canonicalize();
+            if (!code.empty())
+                code = hfmtree.encode(string);
+        }
+        return *this;
+    }
+
+    friend std::ostream &operator<<(std::ostream &o, const HFMString &h)
+    {
+        o << h.hfmtree;
+        const auto &code = h.code.empty() ? h.hfmtree.encode(h.string) : h.code;
+        o.write((const char *)(code.data()), code.size());
+        return o;
+    }
+    /**
+     * @brief write a HFMString object into a file
+     * @param p path of targeting file, defaults to "a.hfmtree"
+     * @param block size of a block of text in bytes, 0 for a single *.hfmtree,
+     *              otherwise a *.hfmtree in blocks is written, its blocks sharing canonical codes of HFMString::hfmtree
+     * @param threads number of threads coding blocks, defaults to HFMPool::default_threads()
+     * @param interleaved whether blocks are coded in HFMTree::streams interleaved streams, defaults to false
+     * @param every number of characters between checkpoints of the seek index of each block, 0 for none (defaults), see HFMView::decode_range
+     * @param checksum whether every block is followed by its CRC32C, see HFMView::verify, defaults to false
+     */
+    void write(const std::filesystem::path &p = std::filesystem::path(), const std::size_t &block = 0,
+               const std::size_t &threads = HFMPool::default_threads(), const bool &interleaved = false, const std::size_t &every = 0,
+               const bool &checksum = false)
+    {
+        std::fstream o((p == std::filesystem::path()) ? std::filesystem::path("a.hfmtree") : p,
+                       std::ios::out | std::ios::binary);
+        write(o, block, threads, interleaved, every, checksum);
+        o.close();
+        return;
+    }
+    /**
+     * @brief write a HFMString object into a stream, e.g. std::cout, see write(p, block, threads, interleaved, every, checksum)
+     * @param o std::ostream, required to be opened in binary mode
+     */
+    void write(std::ostream &o, const std::size_t &block = 0, const std::size_t &threads = HFMPool::default_threads(),
+               const bool &interleaved = false, const std::size_t &every = 0, const bool &checksum = false) const
+    {
+        if (block)
+            HFMStream::compress(o, HFMTree(hfmtree).canonicalize(), string, block, threads, interleaved, every, checksum);
+        else
+            o << *this;
+        return;
+    }
+};
+
+/**
+ * @brief
+ * benchmarks of every stage over synthetic corpora of varied entropy, reported in JSON lines, one object per measurement:
+ * {"profile", "size" (bytes of text), "stage", "ns" (the shortest run), "ns_per_symbol", "mb_per_s", "bits_per_symbol" (size of code)},
+ * the tree-walk decoder, HFMAdaptive and HFMContext measured as baselines of the table-driven engines
+
+ */
+class HFMBench
+{
+public:
+    /** @brief profiles of synthetic corpora */
+    constexpr static std::array<const char *, 4> profiles{"english", "logs", "skewed", "uniform"};
+    /** @brief default sizes of text in bytes */
+    constexpr static std::array<std::size_t, 4> default_sizes{std::size_t(1) << 12, std::size_t(1) << 16, std::size_t(1) << 20, std::size_t(1) << 23};
+
+    /**
+     * @brief generate text of a profile
+     * @param profile one of HFMBench::profiles
+     * @param size size of text in bytes
+     * @param seed seed of random numbers
+     * @return std::string
+     */
+    static std::string corpus(const std::string_view &profile, const std::size_t &size, const uint64_t &seed = 1)
+    {
+        static const std::array<const char *, 32> words{
+            "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by", "on",
+            "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "they", "you", "were", "huffman"};
+        static const std::array<const char *, 4> levels{"INFO", "DEBUG", "WARN", "ERROR"};
+        std::mt19937_64 g(seed);
+        std::string text;
+        text.reserve(size + 128);
+        if (profile == "english")
+            while (text.size() < size)
+            {
+                // Zipf-like choice of words, sentences of 4 to 19 words
+                const std::size_t n = 4 + g() % 16;
+                for (std::size_t k = 0; k < n; k++)
+                {
+                    std::string w = words[std::min<std::size_t>(g() % words.size(), g() % words.size())];
+                    if (!k)
+                        w[0] = char(w[0] - 'a' + 'A');
+                    text += w;
+                    text += (k + 1 == n) ? ". " : ((g() % 9) ? " " : ", ");
+                }
+                if (!(g() % 6))
+                    text += '\n';
+            }
+        else if (profile == "logs")
+            for (uint64_t t = 1700000000000; text.size() < size; t += g() % 1000)
+            {
+                const std::string level = levels[std::min<std::size_t>(g() % 4, g() % 4)];
+                text += std::to_string(t) + " [" + level + "] worker-" + std::to_string(g() % 16) +
+                        " request id=" + std::to_string(g() % 1000000) + " took " + std::to_string(g() % 5000) + "us\n";
+            }
+        else if (profile == "skewed")
+            // geometric distribution, p = 1/2
+            for (; text.size() < size;)
+            {
+                uint8_t c = 0;
+                for (uint64_t r = g(); (r & 1) && c < 30; r >>= 1)
+                    c++;
+                text += char('a' + c);
+            }
+        else if (profile == "uniform")
+            for (; text.size() < size;)
+                text += char(g());
+        else
+            throw std::invalid_argument("invalid profile passed to class HFMBench.");
+        text.resize(size);
+        return text;
+    }
+
+    /**
+     * @brief time a task, repeated until it has run for 0.1s in total (and at least 3 times), the shortest run taken
+     * @param task task
+     * @return double seconds of the shortest run
+     */
+    static double time(const std::function<void()> &task)
+    {
+        using clock = std::chrono::steady_clock;
+        double best = 1e300, total = 0;
+        for (std::size_t k = 0; k < 3 || total < 0.1; k++)
+        {
+            const auto start = clock::now();
+            task();
+            const double t = std::chrono::duration<double>(clock::now() - start).count();
+            best = std::min(best, t);
+            total += t;
+        }
+        return best;
+    }
+
+    /**
+     * @brief run all benchmarks over all profiles and sizes
+     * @param o std::ostream of results, JSON lines
+     * @param sizes sizes of text in bytes
+     */
+    static void run(std::ostream &o, const std::vector<std::size_t> &sizes)
+    {
+        const auto path = std::filesystem::temp_directory_path() / "hfmbench.hfmtree";
+        for (const auto &profile : profiles)
+            for (const auto &size : sizes)
+            {
+                const std::string text = corpus(profile, size);
+                const HFMTree::Counter counter(text);
+                const HFMTree::Tree tree = HFMTree::build_tree(counter);
+                const auto code = HFMTree::generate_code(tree);
+                const HFMTree hfmtree(counter);
+                const auto encoded = hfmtree.encode(text);
+                const auto interleaved = hfmtree.encode_interleaved(text);
+                // bits per symbol of the static code, of the adaptive coders for their stages
+                double bits = double(encoded.size() - sizeof(std::size_t)) * 8 / double(size);
+                std::string decoded(size, '\0');
+                volatile std::size_t sink = 0;
+                const auto report = [&](const char *stage, const double &seconds)
+                {
+                    o << "{\"profile\": \"" << profile << "\", \"size\": " << size << ", \"stage\": \"" << stage
+                      << "\", \"ns\": " << seconds * 1e9 << ", \"ns_per_symbol\": " << seconds * 1e9 / double(size) << ", \"mb_per_s\": " << double(size) / seconds / 1e6
+                      << ", \"bits_per_symbol\": " << bits << "}" << std::endl;
+                };
+                report("count", time([&]()
+                                     { sink = sink + HFMTree::Counter(text)['e']; }));
+                report("build_tree", time([&]()
+                                          { sink = sink + HFMTree::build_tree(counter).root; }));
+                report("generate_code", time([&]()
+                                             { sink = sink + HFMTree::generate_code(tree)['e'].length; }));
+                report("table", time([&]()
+                                     { sink = sink + HFMTree::Table(code).width; }));
+                report("encode", time([&]()
+                                      { sink = sink + hfmtree.encode(text).size(); }));
+                report("decode", time([&]()
+                                      { sink = sink + hfmtree.decode(encoded.data() + sizeof(std::size_t), encoded.data() + encoded.size(),
+                                                                     HFMStream::load(encoded.data()), decoded.data(), size); }));
+                report("decode_interleaved", time([&]()
+                                                  { hfmtree.decode_interleaved(interleaved.data(), interleaved.data() + interleaved.size(), decoded.data(), size); }));
+                report("write", time([&]()
+                                     {
+                                         std::fstream f(path, std::ios::out | std::ios::binary);
+                                         f << hfmtree;
+                                         f.write((const char *)(encoded.data()), encoded.size()); }));
+                report("read", time([&]()
+                                    {
+                                        const HFMView view(path, 1);
+                                        sink = sink + view.decode(decoded.data(), size); }));
+                if (decoded != text)
+                    throw std::runtime_error("benchmark failed to decode its text in class HFMBench.");
+                // baselines of the engines above: decoding bit by bit, walking the tree, and the adaptive coders
+                std::string walked, adapted, modeled;
+                report("decode_walk", time([&]()
+                                           { walked = hfmtree.decode_walk(encoded.begin() + sizeof(std::size_t), encoded.end(), HFMStream::load(encoded.data())); }));
+                std::string adaptive;
+                {
+                    std::istringstream i(text);
+                    std::ostringstream c(std::ios::out | std::ios::binary);
+                    HFMAdaptive::compress(i, c);
+                    adaptive = std::move(c).str();
+                }
+                bits = double(adaptive.size()) * 8 / double(size);
+                report("adaptive_encode", time([&]()
+                                               {
+                                                   std::istringstream i(text);
+                                                   std::ostringstream c(std::ios::out | std::ios::binary);
+                                                   HFMAdaptive::compress(i, c);
+                                                   sink = sink + std::size_t(c.tellp()); }));
+                report("adaptive_decode", time([&]()
+                                               {
+                                                   std::istringstream c(adaptive);
+                                                   std::ostringstream d(std::ios::out | std::ios::binary);
+                                                   HFMAdaptive::decompress(c, d);
+                                                   adapted = std::move(d).str(); }));
+                const auto context = HFMContext::compress(text);
+                bits = double(context.size()) * 8 / double(size);
+                report("context_encode", time([&]()
+                                              { sink = sink + HFMContext::compress(text).size(); }));
+                report("context_decode", time([&]()
+                                              { modeled = HFMContext::decompress(context); }));
+                if (walked != text || adapted != text || modeled != text)
+                    throw std::runtime_error("benchmark failed to decode its text in class HFMBench.");
+            }
+        std::filesystem::remove(path);
+#if defined(HFM_STATS)
+        HFMStats::report(o);
+#endif
+        return;
+    }
+};
+
+/**
+ * @brief
+ * command-line tool compressing and decompressing files or stdin / stdout, and directories of files in batches, see HFMCommand::usage
+ */
+class HFMCommand
+{
+public:
+    /** @brief engines coding a file */
+    enum class Engine : uint8_t
+    {
+        /** @brief a single *.hfmtree with a sequenced tree, decoded by walking the tree bit by bit */
+        walk,
+        /** @brief a single *.hfmtree with canonical codes, decoded with lookup tables */
+        table,
+        /** @brief a *.hfmtree in blocks, each coded in HFMTree::streams interleaved streams decoded side by side */
+        interleaved,
+        /** @brief a *.hfmtree in blocks sharing one tree, coded and decoded on many threads */
+        threads,
+        /** @brief a *.hfmtree in blocks, each with a tree of its own, streamed block by block in constant memory */
+        stream
+    };
+    /** @brief options of a command */
+    struct Options
+    {
         /**
-         * @brief Construct a new Weighted_Node object with 2 sub-trees
-         * @param l left sub-tree
-         * @param r right sub-tree
-         * @param w weight
+         * @brief engine, defaults to Engine::stream for stdin, otherwise to Engine::table for files of a block at most without checksums
+         * and Engine::threads for the others, any engine but Engine::stream decompressing any *.hfmtree of a file,
+         * decompressing stdin defaults to Engine::stream for a *.hfmtree in blocks and Engine::threads otherwise
          */
-        Weighted_Node(Tree l, Tree r, const std::size_t w) : Node(l, r), weight(w) {}
-
-        /** @brief Destructor. Destroy the Node object only, use HFMTree::destroy_tree(Tree t) instead to destroy the whole tree */
-        virtual ~Weighted_Node() = default;
-
-        // Weighted_Node &operator=(const Weighted_Node &other) = default;
-        Weighted_Node &operator=(Weighted_Node &&other) = default;
-
-        /** @brief operator== comparing 2 Nodes by weight */
-        friend inline bool operator>=(const Weighted_Node &a, const Weighted_Node &b) { return a.weight >= b.weight; }
-        constexpr static auto greater_equal = std::greater_equal<const Weighted_Node &>();
+        std::optional<Engine> engine;
+        /** @brief number of threads of Engine::threads, or of workers of a batch, each file of a batch being coded on one thread */
+        std::size_t jobs = HFMPool::default_threads();
+        /** @brief size of a block of text in bytes */
+        std::size_t block = HFMStream::default_block;
+        /** @brief whether every block is followed by its CRC32C */
+        bool checksum = false;
     };
-
-    /** @brief helper class for HFMTree::code */
-    class Code : private std::vector<bool>
+    /** @brief files processed by a batch */
+    struct Summary
     {
-    public:
-        Code() = default;
-        /**
-         * @brief Construct a new Code objecty
-         * @param v const reference to a std::vector<bool> object
-         * @param l length
-         */
-        Code(const std::vector<bool> &v, const uint8_t &l) : std::vector<bool>(v) { resize(l); }
-        Code(const Code &) = default;
-        Code(Code &&) = default;
-        Code &operator=(const Code &) = default;
-        Code &operator=(Code &&) = default;
-        virtual ~Code() = default;
-
-        inline std::size_t size() const { return std::vector<bool>::size(); }
-        inline auto operator[](std::size_t index) { return std::vector<bool>::operator[](index); }
-        inline auto operator[](std::size_t index) const { return std::vector<bool>::operator[](index); }
+        std::size_t files, failed;
+        /** @brief bytes read and written */
+        std::size_t in, out;
+        double seconds;
     };
 
-    static Tree copy_tree(Tree tree)
-    {
-        if (tree == nullptr)
-            return nullptr;
-        return new Node(copy_tree(tree->left), copy_tree(tree->right), tree->value);
-    }
-
+private:
     /**
-     * @brief destroy a tree
-     * @param tree
+     * @brief read a file, or stdin for "-"
+     * @tparam Read callable with std::istream &
+     * @param source path of the file
+     * @param read reading from the stream
      */
-    static void destroy_tree(Tree tree)
+    template <typename Read>
+    static void input(const std::filesystem::path &source, const Read &read)
     {
-        if (tree)
+        if (source == "-")
         {
-            if (tree->left)
-            {
-                destroy_tree(tree->left);
-                destroy_tree(tree->right);
-            }
-            delete tree;
+            read(std::cin);
+            return;
         }
+        std::ifstream i(source, std::ios::in | std::ios::binary);
+        if (!i)
+            throw std::runtime_error("failed to open file in class HFMCommand.");
+        read(i);
         return;
     }
-
     /**
-     * @brief building a huffman tree using a HFMTree::Heap reference
-     * @param heap counting characters, typed HFMTree::Heap&
-     * @return Tree
+     * @brief write a file, or stdout for "-"
+     * @tparam Write callable with std::ostream &
+     * @param target path of the file
+     * @param write writing to the stream
      */
-    static Tree build_tree(Heap &heap)
+    template <typename Write>
+    static void output(const std::filesystem::path &target, const Write &write)
     {
-        std::make_heap(heap.begin(),
-                       heap.end(),
-                       Weighted_Node::greater_equal);
-        while (!heap.front().weight)
+        if (target == "-")
         {
-            std::pop_heap(heap.begin(), heap.end(), Weighted_Node::greater_equal);
-            heap.pop_back();
+            write(std::cout);
+            if (!std::cout.flush())
+                throw std::runtime_error("failed to write to stdout in class HFMCommand.");
+            return;
         }
-        if (heap.size() == 0)
-            throw std::runtime_error("empty text passed to class HFMTree.");
-        if (heap.size() == 1)
-            throw std::runtime_error("single-character-composed text passed to class HFMTree.");
-        Weighted_Node left, right;
-        std::size_t weight;
-        while (heap.size() > 1)
+        std::ofstream o(target, std::ios::out | std::ios::binary);
+        if (!o)
+            throw std::runtime_error("failed to open file in class HFMCommand.");
+        write(o);
+        o.close();
+        if (!o)
+            throw std::runtime_error("failed to write file in class HFMCommand.");
+        return;
+    }
+    /**
+     * @brief read a whole file, or stdin for "-"
+     * @param source path of the file
+     * @return std::string
+     */
+    static std::string read(const std::filesystem::path &source)
+    {
+        std::string text;
+        input(source, [&](std::istream &i)
+              {
+                  if (source != "-")
+                  {
+                      text.resize(std::filesystem::file_size(source));
+                      i.read(text.data(), std::streamsize(text.size()));
+                      text.resize(std::size_t(i.gcount()));
+                      return;
+                  }
+                  // stdin is read a block at a time, its size unknown
+                  while (i)
+                  {
+                      const std::size_t size = text.size();
+                      text.resize(size + HFMStream::default_block);
+                      i.read(text.data() + size, HFMStream::default_block);
+                      text.resize(size + std::size_t(i.gcount()));
+                  } });
+        return text;
+    }
+    /**
+     * @brief parse a positive number of an option
+     * @param value value of the option
+     * @return std::size_t
+     */
+    static std::size_t number(const std::string_view &value)
+    {
+        std::size_t n = 0;
+        for (const char &c : value)
         {
-            std::pop_heap(heap.begin(), heap.end(), Weighted_Node::greater_equal);
-            left = std::move(heap.back());
-            heap.pop_back();
-            std::pop_heap(heap.begin(), heap.end(), Weighted_Node::greater_equal);
-            right = std::move(heap.back());
-            weight = left.weight + right.weight;
-            heap.back() = Weighted_Node(new Node(std::move(left)), new Node(std::move(right)), weight);
-            std::push_heap(heap.begin(), heap.end(), Weighted_Node::greater_equal);
+            if (c < '0' || c > '9' || n > (SIZE_MAX - 9) / 10)
+                throw std::invalid_argument("invalid number passed to class HFMCommand.");
+            n = n * 10 + std::size_t(c - '0');
         }
-        return new Node(std::move(heap[0]));
+        if (!n)
+            throw std::invalid_argument("invalid number passed to class HFMCommand.");
+        return n;
     }
+
+public:
     /**
-     * @brief building a huffman tree using a std::string
-     * @param s source text
-     * @return Tree
+     * @brief print usage
+     * @param o std::ostream
      */
-    static Tree build_tree(const std::string &s)
+    static void usage(std::ostream &o)
     {
-        Heap heap(128);
-        for (std::size_t i = 0; i < 128; i++)
-            heap[i].value = char(i);
-        for (const auto &i : s)
-            heap[i].weight++;
-        return build_tree(heap);
+        o << "usage: huffman compress [options] [source [target]]\n"
+             "       huffman decompress [options] [source [target]]\n"
+             "       huffman batch compress|decompress [options] directory [output directory]\n"
+             "       huffman bench [sizes of text in bytes...]\n"
+             "source and target default to stdin and stdout, \"-\" for either of them,\n"
+             "target defaults to source with \".hfmtree\" added (compress) or removed (decompress) for a file,\n"
+             "a batch codes every file under directory (each *.hfmtree for decompress) into the same place under output directory,\n"
+             "on a pool of workers, each file on one of them, and prints a summary of throughput\n"
+             "options:\n"
+             "  --engine=walk         a single *.hfmtree with a sequenced tree, decoded by walking the tree\n"
+             "  --engine=table        a single *.hfmtree with canonical codes, decoded with lookup tables\n"
+             "  --engine=interleaved  a *.hfmtree in blocks, each coded in 4 interleaved streams\n"
+             "  --engine=threads      a *.hfmtree in blocks sharing one tree, on many threads\n"
+             "  --engine=stream       a *.hfmtree in blocks, streamed block by block\n"
+             "  --jobs=N              number of threads, or of workers of a batch, defaults to the number of hardware threads\n"
+             "  --block=N             size of a block of text in bytes, defaults to 1048576\n"
+             "  --checksum            a CRC32C after every block, checked when it is decoded, not along with walk or table\n"
+             "compress defaults to table for files of one block at most (without --checksum), threads for the others,\n"
+             "and stream for stdin,\n"
+             "decompress reads any *.hfmtree with any engine but walk (single *.hfmtree only) and stream (*.hfmtree in blocks only),\n"
+             "defaulting to threads for files, and for stdin to stream for a *.hfmtree in blocks and threads otherwise\n";
+        return;
     }
     /**
-     * @brief building a huffman tree using a Counter object
-     * @param counter counting characters, typed HFMTree::Counter
-     * @return Tree
+     * @brief engine of a name
+     * @param name one of walk, table, interleaved, threads and stream
+     * @return Engine
      */
-    static Tree build_tree(const Counter &counter)
+    static Engine engine(const std::string_view &name)
     {
-        Heap heap(128);
-        for (std::size_t i = 0; i < counter.size(); i++)
+        constexpr std::array<std::string_view, 5> names{"walk", "table", "interleaved", "threads", "stream"};
+        const auto i = std::find(names.begin(), names.end(), name);
+        if (i == names.end())
+            throw std::invalid_argument("unknown engine passed to class HFMCommand.");
+        return Engine(i - names.begin());
+    }
+    /**
+     * @brief compress a file, or stdin for "-", into a *.hfmtree,
+     * text of a single character is given a dummy second one, empty text is written as a *.hfmtree in blocks without blocks
+     * @param source path of source text
+     * @param target path of targeting file, "-" for stdout
+     * @param options options
+     * @param threads number of threads of Engine::threads and Engine::interleaved
+     */
+    static void compress(const std::filesystem::path &source, const std::filesystem::path &target, const Options &options,
+                         const std::size_t &threads)
+    {
+        // a single *.hfmtree is smaller and built faster for a file of one block, but has no checksum
+        const Engine engine = options.engine.value_or(source == "-" ? Engine::stream
+                                                      : (!options.checksum && std::filesystem::file_size(source) <= options.block)
+                                                          ? Engine::table
+                                                          : Engine::threads);
+        if ((engine == Engine::walk || engine == Engine::table) && options.checksum)
+            throw std::invalid_argument("checksum of a single *.hfmtree passed to class HFMCommand.");
+        if (engine == Engine::stream)
         {
-            heap[i].value = char(i);
-            heap[i].weight = counter[i];
+            input(source, [&](std::istream &i)
+                  { output(target, [&](std::ostream &o)
+                           { HFMStream::compress(i, o, options.block, false, 0, 0, options.checksum); }); });
+            return;
         }
-        return build_tree(heap);
+        std::string text = read(source);
+        output(target, [&](std::ostream &o)
+               {
+                   if (text.empty())
+                   {
+                       std::istringstream i;
+                       HFMStream::compress(i, o, options.block, false, 0, 0, options.checksum);
+                   }
+                   else if (engine == Engine::walk || engine == Engine::table)
+                   {
+                       const bool single = text.find_first_not_of(text[0]) == std::string::npos;
+                       HFMString s = single ? HFMString(HFMStream::train(text), std::move(text)) : HFMString(std::move(text));
+                       if (engine == Engine::table)
+                           s.canonicalize();
+                       s.write(o);
+                   }
+                   else
+                       HFMStream::compress(o, HFMStream::train(text), text, options.block, threads, engine == Engine::interleaved, 0,
+                                           options.checksum); });
+        return;
     }
     /**
-     * @brief build a huffman tree using a sequenced tree [begin, end)
-     * @tparam T iterator type
-     * @param begin begin of the sequence
-     * @param end end of the sequence
-     * @return Tree
+     * @brief decompress a *.hfmtree, or stdin for "-", of any kind
+     * @param source path of the *.hfmtree
+     * @param target path of targeting text, "-" for stdout
+     * @param options options
+     * @param threads number of threads of Engine::threads
      */
-    template <typename RandomAccessIterator>
-    static Tree build_tree(const RandomAccessIterator &begin, const RandomAccessIterator &end)
+    static void decompress(const std::filesystem::path &source, const std::filesystem::path &target, const Options &options,
+                           const std::size_t &threads)
     {
-        if (begin + 1 == end)
-            return nullptr;
-        RandomAccessIterator p = begin + 1;
-        if (*p == 0b10000000)
+        Engine engine = options.engine.value_or(source == "-" ? Engine::stream : Engine::threads);
+        std::string bytes;
+        if (source == "-" && !options.engine)
         {
-            uint8_t count = 1;
-            p++;
-            while (count)
+            // stdin is streamed if it is a *.hfmtree in blocks, told by its magic number, and read into memory otherwise
+            bytes.resize(sizeof(std::size_t));
+            std::cin.read(bytes.data(), sizeof(std::size_t));
+            bytes.resize(std::size_t(std::cin.gcount()));
+            if (bytes.size() == sizeof(std::size_t) && HFMStream::load((const uint8_t *)(bytes.data())) == HFMStream::magic)
             {
-                if (*p == 0b10000000)
-                    count++;
-                else if (*p == 0b10000001)
-                    count--;
-                p++;
+                output(target, [&](std::ostream &o)
+                       { HFMStream::decompress(std::cin, o, true); });
+                return;
             }
-            return new Node(build_tree(begin + 1, p), build_tree(p + 1, end - 1), *p);
+            engine = Engine::threads;
+            bytes += read(source);
+        }
+        else if (engine == Engine::stream)
+        {
+            input(source, [&](std::istream &i)
+                  { output(target, [&](std::ostream &o)
+                           { HFMStream::decompress(i, o); }); });
+            return;
         }
+        else if (source == "-")
+            bytes = read(source);
+        // stdin is read into memory, files are mapped
+        const std::size_t t = (engine == Engine::threads) ? threads : 1;
+        std::optional<HFMView> view;
+        if (source == "-")
+            view.emplace((const uint8_t *)(bytes.data()), (const uint8_t *)(bytes.data()) + bytes.size(), t);
         else
-            return new Node(nullptr, nullptr, *p);
-    }
-
-    /**
-     * @brief helper function for static void generate_code(Tree tree, Code code[])
-     * @param tree HFMTree::tree
-     * @param code HFMTree::code
-     * @param path recording current path, typed std::vector<bool>
-     * @param depth recorcing current depth (also path length), typed uint8_t
-     */
-    static void _generate_code(Tree tree, std::vector<Code> &code, std::vector<bool> &path, const uint8_t &depth)
-    {
-        if (!(tree->left || tree->right))
-            code[std::size_t(tree->value)] = Code(path, depth);
+            view.emplace(source, t);
+        std::string text;
+        if (engine == Engine::walk)
+            text = view->decode_walk();
         else
         {
-            path[depth] = 1;
-            _generate_code(tree->right, code, path, depth + 1);
-            path[depth] = 0;
-            _generate_code(tree->left, code, path, depth + 1);
+            text.resize(view->bound());
+            text.resize(view->decode(text.data(), text.size()));
         }
+        output(target, [&](std::ostream &o)
+               { o.write(text.data(), std::streamsize(text.size())); });
         return;
     }
     /**
-     * @brief helper function for HFMTree(const std::string &s), generating HFMTree::code
-     *
-     * @param tree HFMTree::tree
-     * @param code HFMTree::code
+     * @brief compress every file under a directory, or decompress every *.hfmtree under it, on a pool of options.jobs workers,
+     * each file coded on a single thread, so that workers never wait for each other,
+     * a file failing is reported to std::cerr and counted, the others are still coded
+     * @param compressing whether files are compressed
+     * @param directory source directory
+     * @param output targeting directory, files are written into the same place under it as under directory
+     * @param options options
+     * @return Summary
      */
-    static std::vector<Code> generate_code(Tree tree)
+    static Summary batch(const bool &compressing, const std::filesystem::path &directory, const std::filesystem::path &output,
+                         const Options &options)
     {
-        std::vector<Code> code(128);
-        std::vector<bool> path(128);
-        _generate_code(tree, code, path, 0);
-        return code;
+        const auto start = std::chrono::steady_clock::now();
+        // files are listed before any is written, output may be directory itself
+        std::vector<std::filesystem::path> files;
+        for (const auto &e : std::filesystem::recursive_directory_iterator(directory))
+            if (e.is_regular_file() && (e.path().extension() == ".hfmtree") != compressing)
+                files.emplace_back(e.path());
+        std::sort(files.begin(), files.end());
+        std::atomic<std::size_t> failed(0), in(0), out(0);
+        std::mutex lock;
+        HFMPool::run(files.size(), options.jobs, [&](const std::size_t &k)
+                     {
+                         const std::filesystem::path &source = files[k];
+                         std::filesystem::path target = output / std::filesystem::relative(source, directory);
+                         if (compressing)
+                             target += ".hfmtree";
+                         else
+                             target.replace_extension();
+                         try
+                         {
+                             std::error_code error;
+                             std::filesystem::create_directories(target.parent_path(), error);
+                             if (compressing)
+                                 compress(source, target, options, 1);
+                             else
+                                 decompress(source, target, options, 1);
+                             in += std::filesystem::file_size(source);
+                             out += std::filesystem::file_size(target);
+                         }
+                         catch (const std::exception &e)
+                         {
+                             failed++;
+                             std::lock_guard<std::mutex> guard(lock);
+                             std::cerr << "huffman: " << source.string() << ": " << e.what() << std::endl;
+                         } });
+        return Summary{files.size(), failed, in, out, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count()};
     }
-
     /**
-     * @brief get a huffman tree object from std::fstream, will be used in class HFMString
-     * @param i std::fstream, required to be opened in binary mode
-     * @param h HFMTree object
-     * @return std::fstream&
+     * @brief print a summary of a batch, throughput in MB of text a second
+     * @param o std::ostream
+     * @param s Summary
+     * @param compressing whether files were compressed
      */
-    void get_from_fstream(std::fstream &i)
+    static void report(std::ostream &o, const Summary &s, const bool &compressing)
     {
-        std::size_t l1;
-        i.read((char *)(&l1), sizeof(std::size_t));
-        uint8_t *p = new uint8_t[l1];
-        i.read((char *)(p), l1);
-        *this = HFMTree(p, p + l1);
-        delete[] p;
+        const std::size_t text = compressing ? s.in : s.out;
+        o << s.files << " files, " << s.failed << " failed, " << s.in << " bytes in, " << s.out << " bytes out ("
+          << (text ? 100.0 * double(compressing ? s.out : s.in) / double(text) : 0.0) << "%), " << s.seconds << " s, "
+          << (s.seconds > 0 ? double(text) / s.seconds / 1e6 : 0.0) << " MB/s" << std::endl;
         return;
     }
-
-public:
-    /** @brief counting characters, Counter.size() should be 128*/
-    class Counter : private std::vector<std::size_t>
-    {
-    public:
-        Counter() : std::vector<std::size_t>(128) {}
-        Counter(const Counter &) = default;
-        Counter(Counter &&) = default;
-        virtual ~Counter() = default;
-
-        inline std::size_t &operator[](std::size_t index) noexcept { return std::vector<std::size_t>::operator[](index); }
-        inline const std::size_t &operator[](std::size_t index) const noexcept { return std::vector<std::size_t>::operator[](index); }
-        inline std::size_t size() const noexcept { return std::vector<std::size_t>::size(); }
-    };
-
-    HFMTree() : tree(nullptr), code(128) {}
-    HFMTree(const HFMTree &other) : tree(copy_tree(other.tree)), code(other.code) {}
-    HFMTree(HFMTree &&other) : tree(other.tree), code(std::move(other.code)) { other.tree = nullptr; }
-    HFMTree(const std::string &s) : tree(build_tree(s)), code(generate_code(tree)) {}
-    HFMTree(const char *s) : tree(build_tree(std::string(s))), code(generate_code(tree)) {}
-    HFMTree(const Counter &c) : tree(build_tree(c)), code(generate_code(tree)) {}
-    template <typename RandomAccessIterator>
-    HFMTree(const RandomAccessIterator &begin, const RandomAccessIterator &end)
-        : tree(build_tree(begin, end)), code(generate_code(tree)) {}
-    virtual ~HFMTree() { destroy_tree(tree); }
-    HFMTree &operator=(const HFMTree &other)
-    {
-        tree = copy_tree(other.tree);
-        code = other.code;
-        return *this;
-    }
-    HFMTree &operator=(HFMTree &&other)
-    {
-        tree = other.tree;
-        code = std::move(other.code);
-        other.tree = nullptr;
-        return *this;
-    }
-
     /**
-     * @brief encode a string with the HFMTree object
-     * @param string string to be encoded, typed const string&
-     * @return std::vector<uint8_t> encoded string, first [sizeof(std::size_t) bytes] for length of following code
+     * @brief run a command, see usage
+     * @param argc number of arguments, the name of the program included
+     * @param argv arguments
+     * @return int exit status, 0 for success, 1 for failures, 2 for invalid commands
      */
-    std::vector<uint8_t> encode(const std::string &string) const
+    static int run(const int argc, const char **argv)
     {
-        std::vector<uint8_t> result(sizeof(std::size_t));
-        uint8_t cache(0b00000000), p(0b10000000);
-        for (const auto &i : string)
+        Options options;
+        std::vector<std::string_view> args;
+        try
         {
-            const auto &c = code[std::size_t(i)];
-            for (std::size_t j = 0; j < c.size(); j++)
+            for (int k = 1; k < argc; k++)
             {
-                if (c[j])
-                    cache |= p;
-                p >>= 1;
-                if (!p)
+                const std::string_view a(argv[k]);
+                if (a == "--help" || a == "-h")
                 {
-                    result.emplace_back(cache);
-                    cache = 0b00000000;
-                    p = 0b10000000;
+                    usage(std::cout);
+                    return 0;
                 }
+                else if (a.starts_with("--engine="))
+                    options.engine = engine(a.substr(9));
+                else if (a.starts_with("--jobs="))
+                    options.jobs = number(a.substr(7));
+                else if (a.starts_with("--block="))
+                    options.block = number(a.substr(8));
+                else if (a == "--checksum")
+                    options.checksum = true;
+                else if (a.size() > 1 && a[0] == '-')
+                    throw std::invalid_argument("unknown option passed to class HFMCommand.");
+                else
+                    args.emplace_back(a);
             }
         }
-        uint8_t extra = 0;
-        if (p != 0b10000000)
+        catch (const std::exception &e)
         {
-            result.emplace_back(cache);
-            do
-                extra++;
-            while (p >>= 1);
+            std::cerr << "huffman: " << e.what() << std::endl;
+            usage(std::cerr);
+            return 2;
         }
-        *((std::size_t *)(&(result[0]))) = ((result.size() - sizeof(std::size_t)) << 3) - extra;
-        return result;
-    }
-    /**
-     * @brief decode HFMString::code with the HFMTree object
-     * @tparam RandomAccessIterator
-     * @param begin iterator pointing to the beginning of the code
-     * @param end iterator pointing to the end of the code
-     * @param l2 length of the code in !!!bits!!!
-     * @return std::string
-     */
-    template <typename RandomAccessIterator>
-    std::string decode(const RandomAccessIterator &begin, const RandomAccessIterator &end, const std::size_t &l2) const
-    {
-        std::vector<char> v;
-        std::size_t count = 0;
-        uint8_t p = 0b10000000;
-        Tree t = tree;
-        for (auto _i = begin; _i != end; _i++)
+#if defined(_WIN32)
+        _setmode(_fileno(stdin), _O_BINARY);
+        _setmode(_fileno(stdout), _O_BINARY);
+#endif
+        std::ios::sync_with_stdio(false);
+        try
         {
-            const auto &i = *_i;
-            for (p = 0b10000000; p; p >>= 1)
+            if (!args.empty() && (args[0] == "compress" || args[0] == "decompress") && args.size() <= 3)
             {
-                t = (p & i) ? t->right : t->left;
-                count++;
-                if (t->value != EOF)
+                const bool compressing = args[0] == "compress";
+                const std::filesystem::path source(args.size() > 1 ? args[1] : "-");
+                std::filesystem::path target(args.size() > 2 ? std::filesystem::path(args[2]) : source);
+                if (args.size() <= 2 && source != "-")
                 {
-                    v.push_back(t->value);
-                    t = tree;
-                    if (count == l2)
-                        break;
+                    if (compressing)
+                        target += ".hfmtree";
+                    else if (target.extension() == ".hfmtree")
+                        target.replace_extension();
+                    else
+                        target += ".out";
                 }
+                compressing ? compress(source, target, options, options.jobs) : decompress(source, target, options, options.jobs);
+                return 0;
+            }
+            if (args.size() >= 3 && args.size() <= 4 && args[0] == "batch" && (args[1] == "compress" || args[1] == "decompress"))
+            {
+                const bool compressing = args[1] == "compress";
+                const std::filesystem::path directory(args[2]), output(args.size() > 3 ? args[3] : args[2]);
+                const Summary s = batch(compressing, directory, output, options);
+                report(std::cout, s, compressing);
+                return s.failed ? 1 : 0;
             }
         }
-        return std::string(v.begin(), v.end());
-    }
-    /**
-     * @brief decode HFMString::code with the HFMTree object
-     * @param code HFMString::code to be decoded !!!WITHOUT!!! the part storing l2, typed std::vector<uint8_t>,
-     * @return std::string
-     */
-    inline std::string decode(const std::vector<uint8_t> &code, const std::size_t &l2) const { return decode(code.begin(), code.end(), l2); }
-    /**
-     * @brief decode HFMString::code with the HFMTree object
-     * @param code HFMString::code to be decoded, !!!WITH!!! the part storing l2 typed std::vector<uint8_t>
-     * @return std::string
-     */
-    inline std::string decode(const std::vector<uint8_t> &code) const
-    {
-        std::size_t l2 = *((std::size_t *)(&code[0]));
-        return decode(code.begin() + sizeof(std::size_t), code.end(), l2);
-    }
-
-    /**
-     * @brief operator<< reloaded for std::fstream
-     * @param o std::fstream, required to be opened in binary mode
-     * @param h HFMTree object
-     * @return std::fstream&
-     */
-    friend std::fstream &operator<<(std::fstream &o, const HFMTree &h)
-    {
-        auto s = h.sequence();
-        std::size_t l1 = s.size();
-        o.write((const char *)(&l1), sizeof(std::size_t));
-        o.write((const char *)(&(s[0])), s.size());
-        return o;
-    }
-
-    /** @brief print tree(sequenced)*/
-    void print_tree() const
-    {
-        auto s = sequence();
-        for (const auto &i : s)
+        catch (const std::exception &e)
         {
-            if (i == 0b10000000)
-                std::cout << '(';
-            else if (i == 0b10000001)
-                std::cout << ')';
-            else
-                std::cout << uint16_t(i);
+            std::cerr << "huffman: " << e.what() << std::endl;
+            return 1;
         }
-        std::cout << std::endl;
-        return;
+        usage(std::cerr);
+        return 2;
     }
 };
 
-class HFMString
+int main(const int argc, const char **argv)
 {
-private:
-    std::string string;
-    HFMTree hfmtree;
-    std::vector<uint8_t> code;
-
-public:
-    HFMString() = default;
-    HFMString(const HFMString &) = default;
-    HFMString(HFMString &&) = default;
-    HFMString(const std::string &s) : string(s), hfmtree(string), code(hfmtree.encode(string)) {}
-    HFMString(std::string &&s) : string(s), hfmtree(string), code(hfmtree.encode(string)) {}
-    HFMString(const char *s) : string(s), hfmtree(string), code(hfmtree.encode(string)) {}
-    HFMString(const HFMTree &h, const std::string &s) : string(s), hfmtree(h), code(hfmtree.encode(string)) {}
-    HFMString(HFMTree &&h, const std::string &s) : string(s), hfmtree(h), code(hfmtree.encode(string)) {}
-    HFMString(const HFMTree &h, std::string &&s) : string(s), hfmtree(h), code(hfmtree.encode(string)) {}
-    HFMString(HFMTree &&h, std::string &&s) : string(s), hfmtree(h), code(hfmtree.encode(string)) {}
-    HFMString(const std::filesystem::path &path)
-    {
-        const std::string mode(path.extension().string());
-        if (mode == ".hfmtree")
-        {
-            std::fstream i(path, std::ios::in | std::ios::binary);
-            // initialize hfmtree
-            hfmtree.get_from_fstream(i);
-            // initialize code
-            std::size_t l2;
-            i.read((char *)(&l2), sizeof(std::size_t));
-            std::size_t byte_count = (l2 + 0b111) >> 3;
-            code = std::vector<uint8_t>(byte_count);
-            i.read((char *)(&(code[0])), byte_count);
-            // initialize string
-            string = hfmtree.decode(code, l2);
-            i.close();
-        }
-        else if (mode == ".txt")
-        {
-            std::fstream i(path, std::ios::in);
-            string = std::string(std::istreambuf_iterator<char>(i), std::istreambuf_iterator<char>());
-            hfmtree = HFMTree(string);
-            code = hfmtree.encode(string);
-        }
-        else
-            throw std::invalid_argument("invalid file used to construct a HFMString object");
-    }
-    virtual ~HFMString() = default;
-    operator std::string() const { return string; }
-
-    friend std::fstream &operator<<(std::fstream &o, const HFMString &h)
+    // benchmarks, "bench [sizes of text in bytes...]"
+    if (argc > 1 && std::string_view(argv[1]) == "bench")
     {
-        o << h.hfmtree;
-        o.write((const char *)(&(h.code[0])), h.code.size());
-        return o;
+        std::vector<std::size_t> sizes;
+        for (int i = 2; i < argc; i++)
+            sizes.emplace_back(std::stoull(argv[i]));
+        if (sizes.empty())
+            sizes.assign(HFMBench::default_sizes.begin(), HFMBench::default_sizes.end());
+        HFMBench::run(std::cout, sizes);
+        return 0;
     }
-    /**
-     * @brief write a HFMString object into a file
-     * @param p path of targeting file, defaults to "a.hfmtree"
-     */
-    void write(const std::filesystem::path &p = std::filesystem::path())
+    // the command-line tool, see HFMCommand::usage
+    if (argc > 1)
     {
-        std::fstream o((p == std::filesystem::path()) ? std::filesystem::path("a.hfmtree") : p,
-                       std::ios::out | std::ios::binary);
-        o << *this;
-        o.close();
-        return;
+        const int status = HFMCommand::run(argc, argv);
+#if defined(HFM_STATS)
+        // stdout may carry the decompressed data
+        HFMStats::report(std::cerr);
+#endif
+        return status;
     }
-};
 
-int main(const int argc, const char **argv)
-{
     // // test #1
     // uint64_t n;
     // HFMTree::Counter counter;
@@ -616,6 +5650,147 @@ int main(const int argc, const char **argv)
             break;
         }
     }
+
+    // test #3, a *.hfmtree in blocks with its index truncated or corrupted is decoded by a scan of its blocks, or rejected,
+    // and one truncated into its blocks is rejected
+    std::ostringstream blocked(std::ios::out | std::ios::binary);
+    std::istringstream i3(s1);
+    HFMStream::compress(i3, blocked, 1 << 12, false, 0, 0, true);
+    const std::string file = std::move(blocked).str();
+    // -1 rejected, 0 decoded wrong, 1 decoded
+    const auto decoded = [&](const std::string &f)
+    {
+        try
+        {
+            const HFMView view((const uint8_t *)(f.data()), (const uint8_t *)(f.data()) + f.size(), 1);
+            std::string text(view.bound(), '\0');
+            text.resize(view.decode(text.data(), text.size()));
+            return text == s1 ? 1 : 0;
+        }
+        catch (const std::exception &)
+        {
+            return -1;
+        }
+    };
+    // the end mark, n + 1 entries and n
+    const std::size_t trailer = (HFMStream::load((const uint8_t *)(file.data()) + file.size() - sizeof(std::size_t)) + 1) * 2 * sizeof(std::size_t) +
+                                2 * sizeof(std::size_t);
+    error = error || decoded(file) != 1;
+    for (std::size_t k = 1; k <= trailer + sizeof(std::size_t); k++)
+        error = error || decoded(file.substr(0, file.size() - k)) != (k <= trailer - sizeof(std::size_t) ? 1 : -1);
+    for (std::size_t k = file.size() - trailer; k < file.size(); k++)
+    {
+        std::string f = file;
+        f[k] = char(~f[k]);
+        error = error || !decoded(f);
+    }
+
+    // test #4, round trips of every format and coder, corrupted blocks with checksums rejected
+    const HFMTree::Counter counter(s1);
+    const HFMTree tree(counter);
+    for (int k = 0; k < 5; k++)
+    {
+        // streamed, interleaved, with seek indexes, retrained on drift with checksums, or in parallel
+        std::istringstream i(s1);
+        std::ostringstream b(std::ios::out | std::ios::binary);
+        if (k < 4)
+            HFMStream::compress(i, b, 1 << 12, k == 1, k == 2 ? 256 : 0, k == 3 ? 0.01 : 0, k == 3);
+        else
+            HFMStream::compress(b, HFMStream::train(s1), s1, 1 << 12, 2);
+        const std::string f = std::move(b).str();
+        std::istringstream c(f);
+        std::ostringstream d;
+        HFMStream::decompress(c, d);
+        error = error || d.str() != s1 || decoded(f) != 1;
+        const HFMView view((const uint8_t *)(f.data()), (const uint8_t *)(f.data()) + f.size(), 1);
+        error = error || view.decode_range(5000, 300) != s1.substr(5000, 300);
+    }
+    for (std::size_t k = 1; k < 8; k++)
+    {
+        std::string f = file;
+        f[file.size() * k / 8 - trailer] = char(~f[file.size() * k / 8 - trailer]);
+        std::istringstream c(f);
+        std::ostringstream d;
+        bool rejected = false;
+        try
+        {
+            HFMStream::decompress(c, d);
+        }
+        catch (const std::exception &)
+        {
+            rejected = true;
+        }
+        error = error || !rejected || decoded(f) != -1;
+    }
+    {
+        const auto code = tree.encode(s1);
+        const auto marks = tree.checkpoints(s1, 256);
+        for (const std::size_t offset : {std::size_t(0), std::size_t(256), std::size_t(5000), s1.size() - 10, s1.size() + 10})
+            error = error || tree.decode_range(code, marks, 256, offset, 300) != (offset < s1.size() ? s1.substr(offset, 300) : std::string());
+    }
+    {
+        const HFMTree limited(counter, 9);
+        error = error || limited.longest() > 9 || limited.decode(limited.encode(s1)) != s1;
+    }
+    {
+        std::ostringstream c(std::ios::out | std::ios::binary);
+        counter.write(c);
+        const std::string w = std::move(c).str();
+        const uint8_t *p = (const uint8_t *)(w.data());
+        const HFMTree::Counter read = HFMTree::Counter::read(p, p + w.size());
+        error = error || p != (const uint8_t *)(w.data()) + w.size();
+        for (std::size_t c = 0; c < HFMTree::alphabet; c++)
+            error = error || read[c] != counter[c];
+    }
+    {
+        // every character coded in 8 bits
+        constexpr std::array<uint8_t, HFMTree::alphabet> octets = []()
+        {
+            std::array<uint8_t, HFMTree::alphabet> l{};
+            l.fill(8);
+            return l;
+        }();
+        using Fixed = HFMFixed<octets>;
+        error = error || Fixed::decode(Fixed::encode(s1)) != s1 || Fixed::tree().encode(s1) != Fixed::encode(s1);
+    }
+    error = error || HFMContext::decompress(HFMContext::compress(s1)) != s1;
+    {
+        std::istringstream i(s1);
+        std::stringstream c(std::ios::in | std::ios::out | std::ios::binary);
+        std::ostringstream d;
+        HFMAdaptive::compress(i, c);
+        HFMAdaptive::decompress(c, d);
+        error = error || d.str() != s1;
+    }
+    {
+        HFMDictionary dictionary;
+        const uint64_t id = dictionary.add(HFMDictionary::train(counter)), partial = dictionary.add(HFMTree("aaaabbbcc d"));
+        error = error || dictionary.decode(dictionary.encode(id, s1)) != s1;
+        // characters the dictionary does not code are refused, never dropped
+        bool refused = false;
+        try
+        {
+            dictionary.encode(partial, "abcxyz dab");
+        }
+        catch (const std::invalid_argument &)
+        {
+            refused = true;
+        }
+        error = error || !refused || dictionary.decode(dictionary.encode(partial, "abc dab")) != "abc dab";
+
+    }
+    {
+        // every line an item
+        std::vector<std::string_view> lines;
+        for (std::size_t p = 0, q; p < s1.size(); p = q + 1)
+            lines.emplace_back(std::string_view(s1).substr(p, (q = std::min(s1.find('\n', p), s1.size())) - p));
+        const HFMBatch batch = HFMBatch::encode(tree, lines, 2);
+        std::string text;
+        std::vector<std::size_t> offsets;
+        batch.decode(tree, text, offsets, 2);
+        for (std::size_t k = 0; k < lines.size(); k++)
+            error = error || std::string_view(text).substr(offsets[k], offsets[k + 1] - offsets[k]) != lines[k];
+    }
     std::cout << (error ? "Error" : "No Error") << std::endl;
 
     return 0;